@@ -8,7 +8,11 @@
 #define __CVLIB_HPP__
 
 #include <opencv2/opencv.hpp>
-#include <boost/circular_buffer.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace cvlib
 {
@@ -18,48 +22,397 @@ namespace cvlib
 /// \return segmented image
 cv::Mat split_and_merge(const cv::Mat& image, double stddev);
 
+/// \brief Largest kernel size filtered directly with int16 weights
+///        Measured once against cv::filter2D: it switches to DFT for kernels of 50 taps and more, so its cost
+///        grows slowly with kernel size, while the cost of direct filtering grows as ksize^2
+int max_quantized_kernel();
+
+/// \brief Correlates 8-bit image with kernel quantized to int16 with int32 accumulation, the output is the same
+///        as of cv::filter2D with CV_32F depth up to the quantization error
+///        Kernel gets its own scale s, so response differs from the float one at most by 127.5 * ksize^2 / s,
+///        where s is limited by int16 range of weights and int32 range of the accumulator.
+///        Kernels larger than max_quantized_kernel() are passed to cv::filter2D
+/// \param image, in - CV_8UC1 image
+/// \param kernel, in - square CV_64F kernel
+/// \param response, out - CV_32F response
+/// \param border, in - border extrapolation
+void filter_quantized(const cv::Mat& image, const cv::Mat& kernel, cv::Mat& response, int border = cv::BORDER_REFLECT_101);
+
+/// \brief Optional parameters of texture segmentation
+struct texture_params
+{
+    /// filter 8-bit input with int16 Gabor kernels, see filter_quantized
+    bool quantized = false;
+
+    /// number of eigen-filters replacing the Gabor bank, 0 uses the whole bank
+    /// eigen-filters are principal components of the bank responses, so the image is filtered components times
+    /// instead of once per Gabor kernel, and descriptor is mean and deviation of every eigen-filter response
+    int components = 0;
+
+    /// texture samples to learn eigen-filters from, when empty they are learned from responses around the ROI
+    std::vector<cv::Mat> training;
+
+    /// border extrapolation for filtering of the whole image (cv::BORDER_REFLECT, cv::BORDER_REFLECT_101 or cv::BORDER_REPLICATE),
+    /// so windows centered near the frame border are evaluated as well and the whole frame is classified
+    int border = cv::BORDER_REFLECT_101;
+};
+
 /// \brief Segment texuture on passed image according to sample in ROI
-/// \param image, in - input image
+/// \param image, in - input image, BGR and BGRA images are converted to grayscale
 /// \param roi, in - region with sample texture on passed image
 /// \param eps, in - threshold parameter for texture's descriptor distance
+/// \param params, in - optional parameters, see texture_params
 /// \return binary mask with selected texture
-cv::Mat select_texture(const cv::Mat& image, const cv::Rect& roi, double eps);
+cv::Mat select_texture(const cv::Mat& image, const cv::Rect& roi, double eps, const texture_params& params = texture_params());
+
+class background_model;
+
+/// \brief Connected 8-neighbour region of foreground pixels
+struct blob
+{
+    cv::Rect bbox; ///< bounding box
+    int area = 0; ///< number of pixels
+    cv::Point2d centroid; ///< mean position of pixels
+};
+
+/// \brief Horizontal run of foreground pixels [begin, end) within a mask row
+struct mask_run
+{
+    int begin;
+    int end;
+};
+
+/// \brief Packs 8-bit mask into 1 bit per pixel: CV_8UC1 of rows x (cols + 7) / 8, pixel x is bit x % 8 of byte x / 8
+void pack_mask(const cv::Mat& mask, cv::Mat& packed);
+
+/// \brief Unpacks bit-packed mask of cols pixels per row into 8-bit mask with 255 for set bits
+void unpack_mask(const cv::Mat& packed, int cols, cv::Mat& mask);
+
+/// \brief Intersection of bit-packed masks
+void packed_and(const cv::Mat& a, const cv::Mat& b, cv::Mat& dst);
+
+/// \brief Union of bit-packed masks
+void packed_or(const cv::Mat& a, const cv::Mat& b, cv::Mat& dst);
+
+/// \brief Number of set pixels of bit-packed mask
+int packed_count(const cv::Mat& packed);
+
+/// \brief Run-length encodes 8-bit mask into CV_32SC1 row: rows, cols, then for every row
+///        the number of its runs followed by begin and end of each run
+void encode_rle(const cv::Mat& mask, cv::Mat& rle);
+
+/// \brief Decodes mask written by encode_rle
+void decode_rle(const cv::Mat& rle, cv::Mat& mask);
 
 /// \brief Motion Segmentation algorithm
 class motion_segmentation : public cv::BackgroundSubtractor
 {
     public:
+    /// \brief Per-pixel background model
+    enum class model_type
+    {
+        running_average, ///< exponential blend of frames at 8-bit precision
+        min_max, ///< range of background intensities
+        mean, ///< mean of frames, running one after 1 / rate frames
+        gaussian, ///< single gaussian per element (1G)
+        gmm, ///< mixture of gaussians per pixel
+        running_average_fixed, ///< exponential blend of frames in 8.8 fixed point, learns with rates below 1/256
+        vibe, ///< set of background samples per pixel (ViBe), handles dynamic background
+        codebook ///< few codewords of background intensity ranges per pixel, multi-modal at lower cost than gmm
+    };
+
+    /// \brief learning rate used when negative one is passed to apply
+    static constexpr double default_learning_rate = 0.05;
+
+    /// \brief Format of foreground mask written by apply
+    enum class mask_format
+    {
+        bytes, ///< CV_8UC1 image with 255 for foreground pixels
+        bits, ///< bit-packed mask, see pack_mask
+        rle ///< run-length encoded mask, see encode_rle
+    };
+
     /// \brief ctor
-    motion_segmentation(cv::Mat mean);
+    /// \param mean, in - initial background, 8-bit image
+    /// \param type, in - background model
+    motion_segmentation(cv::Mat mean, model_type type = model_type::running_average);
+
+    /// \brief Copies would share the background model and buffers, so segmentation is move-only
+    motion_segmentation(const motion_segmentation&) = delete;
+    motion_segmentation& operator=(const motion_segmentation&) = delete;
+    motion_segmentation(motion_segmentation&&) = default;
+    motion_segmentation& operator=(motion_segmentation&&) = default;
 
     /// \see cv::BackgroundSubtractor::apply
+    ///      fgmask is written in the format set by set_mask_format
     void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1) override;
 
-    /// \see cv::BackgroundSubtractor::BackgroundSubtractor
-    void getBackgroundImage(cv::OutputArray backgroundImage) const override
+    /// \see cv::BackgroundSubtractor::getBackgroundImage
+    void getBackgroundImage(cv::OutputArray backgroundImage) const override;
+
+    /// \brief Sets threshold of intensity difference for foreground pixels
+    ///        gaussian and gmm scale it by learned deviation: foreground is farther than threshold / 10 deviations
+    void set_threshold(double threshold);
+
+    /// \brief Enables per-pixel learning rate, which grows with the number of frames pixel stays background
+    ///        up to twice the rate passed to apply and falls to its half when pixel changes
+    ///        Supported by model_type::running_average
+    void set_adaptive_rate(bool enabled);
+
+    /// \brief Type of the background model
+    model_type type() const;
+
+    /// \brief Writes the whole model state into versioned binary snapshot
+    void save(const std::string& path) const;
+
+    /// \brief Replaces the model by the one from snapshot written by save
+    ///        The file is memory-mapped and the model works on its private copy-on-write pages,
+    ///        so only pages being changed are copied
+    void load(const std::string& path);
+
+    /// \brief Sets minimal number of rows processed by one task of the thread pool
+    ///        apply splits the frame into tiles of rows which run in parallel through cv::parallel_for_,
+    ///        so the number of threads is controlled by cv::setNumThreads
+    void set_min_tile_rows(int rows);
+
+    /// \brief Enables block-level change gating
+    ///        Each block is first compared with the background image, blocks with mean absolute difference
+    ///        below noise_floor are marked background without per-pixel processing and model update
+    /// \param block_size, in - side of square block in pixels, 0 disables gating
+    /// \param noise_floor, in - mean absolute difference per channel value
+    void set_block_gating(int block_size, double noise_floor);
+
+    /// \brief Sets format of the mask written by apply, compact formats are produced row by row
+    ///        right after the model classifies the row
+    void set_mask_format(mask_format format);
+
+    /// \brief Enables extraction of foreground blobs by apply
+    ///        runs of each mask row are collected right after the row is produced, then runs are labeled in one pass
+    void set_blob_output(bool enabled);
+
+    /// \brief Foreground blobs of the last processed frame, empty when blob output is disabled
+    ///        with processing scale they are found in the final full-resolution mask, after edge refinement and ROI
+    const std::vector<blob>& blobs() const
     {
-        backgroundImage.assign(bg_model_);
+        return blobs_;
     }
 
+    /// \brief Sets scale the model runs at, frames are area-downsampled by factor and the mask is upsampled back
+    ///        The model is recreated from its background image resampled to the new scale, so it is to be set
+    ///        before processing; getBackgroundImage and snapshots are at processing scale
+    /// \param factor, in - downsampling factor, 1 processes full resolution
+    /// \param refine_edges, in - reclassify full-resolution pixels near mask boundaries against the background
+    void set_processing_scale(int factor, bool refine_edges = false);
+
+    /// \brief Restricts processing to region of interest, pixels outside of it are background and their model is not updated
+    ///        The mask is converted once to spans of rows, so processing cost scales with the watched area
+    /// \param roi, in - CV_8UC1 mask of frame size, nonzero inside the region; empty one processes the whole frame
+    void set_roi(const cv::Mat& roi);
+
     private:
-    cv::Mat bg_model_;
+    /// \brief ROI spans of model row y, nullptr when there is no ROI
+    const std::vector<mask_run>* roi_row(int y) const
+    {
+        return roi_spans_.empty() ? nullptr : &roi_spans_[y];
+    }
+
+    bool roi_covers(const cv::Rect& rect) const;
+    void update_roi_spans();
+    void segment(const cv::Mat& image, cv::Mat& fgmask, float rate);
+    void refine_edges(const cv::Mat& image, cv::Mat& fgmask);
+    void process_blocks(const cv::Mat& image, cv::Mat& fgmask, float rate);
+    void emit_row(const cv::Mat& fgmask, int y);
+    void label_runs();
+
+    cv::Ptr<background_model> model_;
+    int min_tile_rows_ = 16;
+    int block_size_ = 0;
+    double noise_floor_ = 0;
+    cv::Mat block_background_; ///< background image refreshed only in processed blocks
+    bool blob_output_ = false;
+    mask_format mask_format_ = mask_format::bytes;
+    bool collect_runs_ = false; ///< emit_row fills row_runs_
+    cv::Mat packed_; ///< emit_row packs rows into it when not empty
+    cv::Mat byte_mask_; ///< 8-bit mask for compact formats
+    std::vector<std::vector<mask_run>> row_runs_; ///< runs of foreground pixels of each row of the last mask
+    std::vector<blob> blobs_;
+    cv::Size frame_size_; ///< size of input frames
+    int scale_ = 1;
+    bool refine_edges_ = false;
+    cv::Mat small_frame_;
+    cv::Mat small_mask_;
+    cv::Mat small_background_;
+    cv::Mat roi_; ///< region of interest at frame resolution, 255 inside
+    std::vector<std::vector<mask_run>> roi_spans_; ///< spans of ROI in rows of the model
 };
 
+/// \brief Ring of last frames with running sum, so mean of any length costs a single conversion
+///        Frames are copied into slots of one preallocated block (rows of every slot are 64-byte aligned),
+///        so buffer owns its frames and pushing frames of the same size and type never allocates memory
 class Buffer {
 private:
-    boost::circular_buffer<cv::Mat> _buffer;
+    size_t _capacity;
+    size_t _size = 0; ///< number of stored frames
+    size_t _head = 0; ///< slot for the next frame
+    std::vector<uchar> _storage; ///< memory of all slots
+    std::vector<cv::Mat> _slots; ///< headers of slots inside _storage
+    cv::Mat _sum; ///< CV_32S sum of stored frames
+
+    void allocate(const cv::Mat& frame);
+
 public:
     Buffer(size_t buff_size);
-    void push_back(cv::Mat);
-    cv::Mat get_mean();
+    /// \brief Copies 8-bit frame into the next slot, evicting the oldest one when buffer is full
+    ///        Frame of other size or type drops stored frames and reallocates slots
+    void push_back(const cv::Mat& frame);
+    /// \brief Mean of stored frames
+    cv::Mat get_mean() const;
+    /// \brief Mean of stored frames written into passed matrix, which is reused when possible
+    void get_mean(cv::Mat& mean) const;
+    /// \brief Number of stored frames
+    size_t size() const
+    {
+        return _size;
+    }
+    /// \brief Stored frame, 0 is the oldest one; the view is valid until the slot is overwritten
+    const cv::Mat& operator[](size_t idx) const;
+};
+
+/// \brief Runs motion segmentation under end-to-end latency budget
+///        Frames whose waiting time plus expected processing time (running average of measured ones) exceed the budget
+///        are skipped. For models blending frames exponentially (running_average, running_average_fixed, gaussian)
+///        the next processed frame gets learning rate 1 - (1 - rate)^(skipped + 1), so the model adapts at the same speed
+///        per second as without skipping; other models get the rate unchanged
+class segmentation_scheduler
+{
+    public:
+    /// \brief ctor
+    /// \param segmentation, in - segmentation to run, must outlive the scheduler
+    /// \param latency_ms, in - budget from capture to ready mask
+    segmentation_scheduler(motion_segmentation& segmentation, double latency_ms);
+
+    /// \brief Processes frame or skips it
+    /// \param capture_ticks, in - cv::getTickCount() at capture, 0 for now
+    /// \return false when frame is skipped, fgmask is not changed then
+    bool process(const cv::Mat& frame, cv::OutputArray fgmask, double learning_rate = -1, int64 capture_ticks = 0);
+
+    /// \brief Sets latency budget in milliseconds
+    void set_latency(double latency_ms);
+
+    /// \brief Sets maximal number of frames skipped in a row, so the model keeps learning when budget cannot be met
+    void set_max_skipped(int frames);
+
+    /// \brief Running average of processing time in milliseconds
+    double processing_ms() const
+    {
+        return processing_ms_;
+    }
+
+    size_t processed() const
+    {
+        return processed_;
+    }
+
+    size_t skipped() const
+    {
+        return skipped_;
+    }
+
+    private:
+    motion_segmentation& segmentation_;
+    double latency_ms_;
+    int max_skipped_ = 30;
+    int skipped_in_row_ = 0;
+    double processing_ms_ = 0;
+    size_t processed_ = 0;
+    size_t skipped_ = 0;
+};
+
+/// \brief Background subtraction for many video streams sharing one thread pool
+///        Each stream keeps only its latest submitted frame, process_batch runs all pending frames
+///        as one cv::parallel_for_ over streams, row tiles of each stream are processed inline then
+class multi_stream_segmentation
+{
+    public:
+    /// \brief Per-stream counters, latency is measured from submit to the ready mask
+    struct stream_stats
+    {
+        size_t processed = 0; ///< number of processed frames
+        size_t dropped = 0; ///< number of frames replaced by newer ones before processing
+        double last_latency_ms = 0;
+        double mean_latency_ms = 0;
+    };
+
+    /// \brief Adds stream with its own model
+    /// \return index of the stream
+    int add_stream(const cv::Mat& background, motion_segmentation::model_type type = motion_segmentation::model_type::running_average);
+
+    /// \brief Number of streams
+    int streams() const
+    {
+        return static_cast<int>(streams_.size());
+    }
+
+    /// \brief Copies frame as pending one of the stream, an unprocessed pending frame is dropped
+    ///        May be called from capture threads concurrently with process_batch
+    void submit(int stream, const cv::Mat& frame);
+
+    /// \brief Processes pending frames of all streams
+    /// \return number of processed frames
+    int process_batch(double learning_rate = -1);
+
+    /// \brief Model of the stream, to be configured between batches
+    motion_segmentation& segmentation(int stream);
+
+    /// \brief Copy of the mask of the last processed frame of the stream
+    ///        May be called concurrently with process_batch
+    cv::Mat mask(int stream) const;
+
+    /// \brief Counters of the stream
+    stream_stats stats(int stream) const;
+
+    private:
+    struct stream
+    {
+        stream(const cv::Mat& background, motion_segmentation::model_type type) : segmentation(background, type) {}
+
+        motion_segmentation segmentation;
+        mutable std::mutex lock; ///< guards pending frame, mask and counters
+        cv::Mat pending;
+        int64 pending_ticks = 0;
+        bool has_pending = false;
+        cv::Mat frame; ///< frame being processed
+        int64 frame_ticks = 0;
+        cv::Mat result; ///< mask being produced, swapped with mask once ready
+        cv::Mat mask;
+        stream_stats stats;
+    };
+
+    std::vector<std::unique_ptr<stream>> streams_;
 };
 
 /// \brief FAST corner detection algorithm
 class corner_detector_fast : public cv::Feature2D
 {
     public:
+    /// \brief Number of contiguous circle pixels which all are brighter or all are darker than the corner
+    enum class detector_type
+    {
+        fast_9 = 9, ///< fastest and most repeatable, detects more corners
+        fast_10 = 10,
+        fast_12 = 12 ///< fewest corners, strongest early rejection
+    };
+
     /// \brief Fabrique method for creating FAST detector
-    static cv::Ptr<corner_detector_fast> create();
+    /// \param threshold, in - minimum intensity difference of arc pixels and the corner, in [0, 255)
+    /// \param type, in - length of the arc
+    static cv::Ptr<corner_detector_fast> create(int threshold = 30, detector_type type = detector_type::fast_12);
+
+    /// \brief Sets minimum intensity difference of arc pixels and the corner, in [0, 255)
+    void set_threshold(int threshold);
+
+    /// \brief Sets length of the arc
+    void set_type(detector_type type);
 
     /// \see Feature2d::detect
     virtual void detect(cv::InputArray image, CV_OUT std::vector<cv::KeyPoint>& keypoints, cv::InputArray mask = cv::noArray()) override;
@@ -76,6 +429,18 @@ class corner_detector_fast : public cv::Feature2D
     {
         return "FAST_Binary";
     }
+
+    /// \brief Enables 3x3 non-maximum suppression of corner scores, enabled by default
+    ///        Keypoint response is the score, i.e. the maximum threshold for which the corner is still detected
+    void set_nonmax_suppression(bool enabled)
+    {
+        nonmax_suppression_ = enabled;
+    }
+
+    private:
+    int threshold_ = 30;
+    detector_type type_ = detector_type::fast_12;
+    bool nonmax_suppression_ = true;
 };
 
 /// \brief Descriptor matched based on ratio of SSD
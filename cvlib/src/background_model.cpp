@@ -0,0 +1,1025 @@
+/* Background models for motion segmentation implementation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include "background_model.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
+
+namespace
+{
+using cvlib::background_model;
+using cvlib::elementwise_model;
+
+#if CV_SIMD128
+/// \brief (b * (256 - a) + s * a + 128) >> 8 for 16 pixels with weights a_lo of 8 low and a_hi of 8 high ones,
+///        the sum fits into 16 bits
+inline cv::v_uint8x16 blend_q8(const cv::v_uint8x16& s, const cv::v_uint8x16& b, const cv::v_uint16x8& a_lo, const cv::v_uint16x8& a_hi)
+{
+    const cv::v_uint16x8 half = cv::v_setall_u16(128);
+    const cv::v_uint16x8 full = cv::v_setall_u16(256);
+    cv::v_uint16x8 s_lo;
+    cv::v_uint16x8 s_hi;
+    cv::v_uint16x8 b_lo;
+    cv::v_uint16x8 b_hi;
+    cv::v_expand(s, s_lo, s_hi);
+    cv::v_expand(b, b_lo, b_hi);
+    const cv::v_uint16x8 lo = (cv::v_mul_wrap(b_lo, full - a_lo) + cv::v_mul_wrap(s_lo, a_lo) + half) >> 8;
+    const cv::v_uint16x8 hi = (cv::v_mul_wrap(b_hi, full - a_hi) + cv::v_mul_wrap(s_hi, a_hi) + half) >> 8;
+    return cv::v_pack(lo, hi);
+}
+
+/// \brief Per-pixel Q8 weights of 16 pixels, base * (stable + 16) / 32 limited by 256
+inline void adaptive_q8(const cv::v_uint8x16& stable, const cv::v_uint16x8& base, cv::v_uint16x8& a_lo, cv::v_uint16x8& a_hi)
+{
+    const cv::v_uint16x8 offset = cv::v_setall_u16(16);
+    const cv::v_uint16x8 full = cv::v_setall_u16(256);
+    cv::v_uint16x8 c_lo;
+    cv::v_uint16x8 c_hi;
+    cv::v_expand(stable, c_lo, c_hi);
+    a_lo = cv::v_min(cv::v_mul_wrap(base, c_lo + offset) >> 5, full);
+    a_hi = cv::v_min(cv::v_mul_wrap(base, c_hi + offset) >> 5, full);
+}
+#endif
+
+/// \brief Exponential blend of frames kept at 8-bit precision
+///        Model update, difference, threshold and channel reduction are fused into a single pass over the row.
+///        With adaptive rate each pixel counts frames it stays background (up to max_stable) in its own plane
+///        and learns with rate * (stable + 16) / 32: from half of the rate right after a change,
+///        so flickering regions keep their model, up to twice the rate, so static regions converge fast
+class running_average : public background_model
+{
+    public:
+    running_average(const cv::Mat& background) : background_model(background)
+    {
+        add_plane(CV_8U, background);
+    }
+
+    void set_adaptive_rate(bool enabled) override
+    {
+        if (enabled && planes_.size() == 1)
+            add_plane(CV_8U, false);
+        else if (!enabled && planes_.size() == 2)
+            planes_.pop_back();
+    }
+
+    std::vector<double> scalars() const override
+    {
+        return {threshold_, planes_.size() == 2 ? 1.0 : 0.0};
+    }
+
+    void set_scalars(const std::vector<double>& values) override
+    {
+        CV_Assert(values.size() == 2);
+        background_model::set_scalars(values);
+        set_adaptive_rate(values[1] != 0);
+    }
+
+    void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) override
+    {
+        // blend weight in Q8
+        const int a = std::min(std::max(cvRound(rate * 256), 0), 256);
+        const int thr = std::min(std::max(cvFloor(threshold_), 0), 255);
+        uchar* bg = planes_[0].ptr<uchar>(y);
+        uchar* stable = planes_.size() == 2 ? planes_[1].ptr<uchar>(y) : nullptr;
+
+        int x = x_begin;
+#if CV_SIMD128
+        const cv::v_uint16x8 va = cv::v_setall_u16(static_cast<ushort>(a));
+        const cv::v_uint8x16 vthr = cv::v_setall_u8(static_cast<uchar>(thr));
+        const cv::v_uint8x16 one = cv::v_setall_u8(1);
+        const cv::v_uint8x16 vmax = cv::v_setall_u8(max_stable);
+        cv::v_uint16x8 a_lo = va;
+        cv::v_uint16x8 a_hi = va;
+        if (cn_ == 1)
+        {
+            for (; x <= x_end - 16; x += 16)
+            {
+                if (stable)
+                    adaptive_q8(cv::v_load(stable + x), va, a_lo, a_hi);
+                const cv::v_uint8x16 s = cv::v_load(src + x);
+                const cv::v_uint8x16 b = blend_q8(s, cv::v_load(bg + x), a_lo, a_hi);
+                const cv::v_uint8x16 fg = cv::v_absdiff(s, b) > vthr;
+                cv::v_store(bg + x, b);
+                cv::v_store(mask + x, fg);
+                if (stable)
+                    cv::v_store(stable + x, cv::v_min(cv::v_load(stable + x) + one, vmax) & ~fg);
+            }
+        }
+        else if (cn_ == 3)
+        {
+            for (; x <= x_end - 16; x += 16)
+            {
+                if (stable)
+                    adaptive_q8(cv::v_load(stable + x), va, a_lo, a_hi);
+                cv::v_uint8x16 s0;
+                cv::v_uint8x16 s1;
+                cv::v_uint8x16 s2;
+                cv::v_uint8x16 b0;
+                cv::v_uint8x16 b1;
+                cv::v_uint8x16 b2;
+                cv::v_load_deinterleave(src + 3 * x, s0, s1, s2);
+                cv::v_load_deinterleave(bg + 3 * x, b0, b1, b2);
+                b0 = blend_q8(s0, b0, a_lo, a_hi);
+                b1 = blend_q8(s1, b1, a_lo, a_hi);
+                b2 = blend_q8(s2, b2, a_lo, a_hi);
+                cv::v_store_interleave(bg + 3 * x, b0, b1, b2);
+                const cv::v_uint8x16 fg = (cv::v_absdiff(s0, b0) > vthr) | (cv::v_absdiff(s1, b1) > vthr) | (cv::v_absdiff(s2, b2) > vthr);
+                cv::v_store(mask + x, fg);
+                if (stable)
+                    cv::v_store(stable + x, cv::v_min(cv::v_load(stable + x) + one, vmax) & ~fg);
+            }
+        }
+#endif
+        for (; x < x_end; ++x)
+        {
+            const int ax = stable ? std::min(a * (stable[x] + 16) >> 5, 256) : a;
+            uchar fg = 0;
+            for (int e = x * cn_; e < (x + 1) * cn_; ++e)
+            {
+                bg[e] = static_cast<uchar>((bg[e] * (256 - ax) + src[e] * ax + 128) >> 8);
+                fg |= std::abs(src[e] - bg[e]) > thr ? 255 : 0;
+            }
+            mask[x] = fg;
+            if (stable)
+                stable[x] = fg ? 0 : static_cast<uchar>(std::min(stable[x] + 1, static_cast<int>(max_stable)));
+        }
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const uchar* bg = planes_[0].ptr<uchar>(y);
+        std::copy(bg + x_begin * cn_, bg + x_end * cn_, dst + x_begin * cn_);
+    }
+
+    private:
+    static constexpr uchar max_stable = 48;
+};
+
+constexpr uchar running_average::max_stable;
+
+#if CV_SIMD128
+/// \brief Updates 8 elements of 8.8 fixed point model with Q15 rate and returns their foreground flags
+inline cv::v_uint16x8 update_q88(const uchar* src, ushort* bg, const cv::v_int32x4& a, const cv::v_uint16x8& thr)
+{
+    const cv::v_int32x4 half = cv::v_setall_s32(1 << 14);
+    const cv::v_uint16x8 s = cv::v_load_expand(src) << 8;
+    cv::v_uint32x4 s_lo;
+    cv::v_uint32x4 s_hi;
+    cv::v_uint32x4 b_lo;
+    cv::v_uint32x4 b_hi;
+    cv::v_expand(s, s_lo, s_hi);
+    cv::v_expand(cv::v_load(bg), b_lo, b_hi);
+
+    const cv::v_int32x4 lo = cv::v_reinterpret_as_s32(b_lo);
+    const cv::v_int32x4 hi = cv::v_reinterpret_as_s32(b_hi);
+    const cv::v_int32x4 d_lo = cv::v_reinterpret_as_s32(s_lo) - lo;
+    const cv::v_int32x4 d_hi = cv::v_reinterpret_as_s32(s_hi) - hi;
+    const cv::v_uint16x8 b = cv::v_pack_u(lo + ((d_lo * a + half) >> 15), hi + ((d_hi * a + half) >> 15));
+    cv::v_store(bg, b);
+    return cv::v_absdiff(s, b) > thr;
+}
+#endif
+
+/// \brief Exponential blend of frames kept in 8.8 fixed point with Q15 learning rate
+///        Rates down to 1/512 still move the model towards one level of intensity difference,
+///        while the model takes half of the memory and bandwidth of the float one
+class running_average_fixed : public elementwise_model
+{
+    public:
+    running_average_fixed(const cv::Mat& background) : elementwise_model(background)
+    {
+        cv::Mat& bg = add_plane(CV_16U, background);
+        bg.convertTo(bg, CV_16U, 256);
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const ushort* bg = planes_[0].ptr<ushort>(y);
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            dst[e] = static_cast<uchar>((bg[e] + 128) >> 8);
+        }
+    }
+
+    protected:
+    void process_elements(int y, const uchar* src, uchar* flags, int begin, int end, float rate) override
+    {
+        // (difference in 8.8) * (rate in Q15) fits into int32
+        const int a = std::min(std::max(cvRound(rate * 32768), 0), 32768);
+        const int thr = std::min(std::max(cvRound(threshold_ * 256), 0), 65535);
+        ushort* bg = planes_[0].ptr<ushort>(y);
+
+        int e = begin;
+#if CV_SIMD128
+        const cv::v_int32x4 va = cv::v_setall_s32(a);
+        const cv::v_uint16x8 vthr = cv::v_setall_u16(static_cast<ushort>(thr));
+        for (; e <= end - 16; e += 16)
+        {
+            const cv::v_uint16x8 lo = update_q88(src + e, bg + e, va, vthr);
+            const cv::v_uint16x8 hi = update_q88(src + e + 8, bg + e + 8, va, vthr);
+            cv::v_store(flags + e - begin, cv::v_pack(lo, hi));
+        }
+#endif
+        for (; e < end; ++e)
+        {
+            const int s = src[e] << 8;
+            const int b = bg[e] + (((s - bg[e]) * a + (1 << 14)) >> 15);
+            bg[e] = static_cast<ushort>(b);
+            flags[e - begin] = std::abs(s - b) > thr ? 255 : 0;
+        }
+    }
+};
+
+/// \brief Range of background intensities, element is background when it is inside the range extended by threshold
+class min_max : public elementwise_model
+{
+    public:
+    min_max(const cv::Mat& background) : elementwise_model(background)
+    {
+        add_plane(CV_32F, background);
+        add_plane(CV_32F, background);
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const float* lo = planes_[lo_plane].ptr<float>(y);
+        const float* hi = planes_[hi_plane].ptr<float>(y);
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            dst[e] = cv::saturate_cast<uchar>(0.5f * (lo[e] + hi[e]));
+        }
+    }
+
+    protected:
+    void process_elements(int y, const uchar* src, uchar* flags, int begin, int end, float rate) override
+    {
+        float* lo = planes_[lo_plane].ptr<float>(y);
+        float* hi = planes_[hi_plane].ptr<float>(y);
+        for (int e = begin; e < end; ++e)
+        {
+            const float v = src[e];
+            const bool fg = v < lo[e] - threshold_ || v > hi[e] + threshold_;
+            flags[e - begin] = fg ? 255 : 0;
+
+            // bounds of background element instantly cover its value and shrink towards it with learning rate
+            const float new_lo = std::min(v, lo[e] + rate * (v - lo[e]));
+            const float new_hi = std::max(v, hi[e] + rate * (v - hi[e]));
+            lo[e] = fg ? lo[e] : new_lo;
+            hi[e] = fg ? hi[e] : new_hi;
+        }
+    }
+
+    private:
+    enum
+    {
+        lo_plane,
+        hi_plane
+    };
+};
+
+/// \brief Mean of all frames, which becomes running average once 1 / rate frames are seen
+class mean : public elementwise_model
+{
+    public:
+    mean(const cv::Mat& background) : elementwise_model(background)
+    {
+        add_plane(CV_32F, background);
+    }
+
+    void next_frame() override
+    {
+        ++frames_;
+    }
+
+    std::vector<double> scalars() const override
+    {
+        return {threshold_, static_cast<double>(frames_)};
+    }
+
+    void set_scalars(const std::vector<double>& values) override
+    {
+        CV_Assert(values.size() == 2);
+        background_model::set_scalars(values);
+        frames_ = static_cast<int>(values[1]);
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const float* m = planes_[0].ptr<float>(y);
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            dst[e] = cv::saturate_cast<uchar>(m[e]);
+        }
+    }
+
+    protected:
+    void process_elements(int y, const uchar* src, uchar* flags, int begin, int end, float rate) override
+    {
+        const float r = std::max(rate, 1.0f / frames_);
+        float* m = planes_[0].ptr<float>(y);
+        for (int e = begin; e < end; ++e)
+        {
+            const float d = src[e] - m[e];
+            flags[e - begin] = std::abs(d) > threshold_ ? 255 : 0;
+            m[e] += r * d;
+        }
+    }
+
+    private:
+    int frames_ = 1; // initial background is the first frame
+};
+
+/// \brief Deviation at which threshold is the foreground distance of gaussian models (default threshold is 2.5 sigmas)
+const float reference_dev = 10.0f;
+
+/// \brief Squared number of deviations from the mean for foreground elements
+inline float sigmas2(float threshold)
+{
+    return threshold * threshold / (reference_dev * reference_dev);
+}
+
+/// \brief Single gaussian per element (1G), only background elements are learned
+class gaussian : public elementwise_model
+{
+    public:
+    gaussian(const cv::Mat& background) : elementwise_model(background)
+    {
+        add_plane(CV_32F, background);
+        add_plane(CV_32F).setTo(reference_dev * reference_dev);
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const float* m = planes_[mean_plane].ptr<float>(y);
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            dst[e] = cv::saturate_cast<uchar>(m[e]);
+        }
+    }
+
+    protected:
+    void process_elements(int y, const uchar* src, uchar* flags, int begin, int end, float rate) override
+    {
+        float* m = planes_[mean_plane].ptr<float>(y);
+        float* var = planes_[var_plane].ptr<float>(y);
+        const float k2 = sigmas2(threshold_);
+        for (int e = begin; e < end; ++e)
+        {
+            const float d = src[e] - m[e];
+            const bool fg = d * d > k2 * var[e];
+            flags[e - begin] = fg ? 255 : 0;
+
+            const float r = fg ? 0.0f : rate;
+            m[e] += r * d;
+            var[e] = std::min(std::max(var[e] + r * (d * d - var[e]), min_var), max_var);
+        }
+    }
+
+    private:
+    enum
+    {
+        mean_plane,
+        var_plane
+    };
+
+    static constexpr float min_var = 4.0f * 4.0f;
+    static constexpr float max_var = 75.0f * 75.0f;
+};
+
+constexpr float gaussian::min_var;
+constexpr float gaussian::max_var;
+
+/// \brief Mixture of gaussians per pixel with isotropic variance over channels
+///        Modes are kept sorted by weight / sigma, the most probable ones with total weight below
+///        background_ratio describe background
+class gmm : public background_model
+{
+    public:
+    gmm(const cv::Mat& background) : background_model(background)
+    {
+        for (int k = 0; k < modes; ++k)
+        {
+            add_plane(CV_32F, false);
+        }
+        for (int k = 0; k < modes; ++k)
+        {
+            add_plane(CV_32F, false).setTo(init_var);
+        }
+        add_plane(CV_32F, background);
+        for (int k = 1; k < modes; ++k)
+        {
+            add_plane(CV_32F);
+        }
+        planes_[0].setTo(1.0f);
+    }
+
+    void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) override
+    {
+        float* w[modes];
+        float* var[modes];
+        float* mu[modes];
+        for (int k = 0; k < modes; ++k)
+        {
+            w[k] = planes_[k].ptr<float>(y);
+            var[k] = planes_[modes + k].ptr<float>(y);
+            mu[k] = planes_[2 * modes + k].ptr<float>(y);
+        }
+
+        const float k2 = sigmas2(threshold_) * cn_;
+        for (int x = x_begin; x < x_end; ++x)
+        {
+            const uchar* p = src + x * cn_;
+            const int e = x * cn_;
+
+            int matched = -1;
+            for (int k = 0; k < modes && matched < 0; ++k)
+            {
+                float d2 = 0.0f;
+                for (int c = 0; c < cn_; ++c)
+                {
+                    const float d = p[c] - mu[k][e + c];
+                    d2 += d * d;
+                }
+                if (w[k][x] > 0.0f && d2 < k2 * var[k][x])
+                    matched = k;
+            }
+
+            float before = 0.0f;
+            for (int k = 0; k < matched; ++k)
+            {
+                before += w[k][x];
+            }
+            mask[x] = matched >= 0 && before < background_ratio ? 0 : 255;
+
+            for (int k = 0; k < modes; ++k)
+            {
+                w[k][x] *= 1.0f - rate;
+            }
+
+            if (matched >= 0)
+            {
+                w[matched][x] += rate;
+                const float rho = std::min(1.0f, rate / w[matched][x]);
+                float d2 = 0.0f;
+                for (int c = 0; c < cn_; ++c)
+                {
+                    const float d = p[c] - mu[matched][e + c];
+                    mu[matched][e + c] += rho * d;
+                    d2 += d * d;
+                }
+                var[matched][x] = std::min(std::max(var[matched][x] + rho * (d2 / cn_ - var[matched][x]), min_var), max_var);
+            }
+            else
+            {
+                // the least probable mode is replaced by the new one
+                matched = modes - 1;
+                w[matched][x] = rate;
+                var[matched][x] = init_var;
+                for (int c = 0; c < cn_; ++c)
+                {
+                    mu[matched][e + c] = p[c];
+                }
+            }
+
+            float total = 0.0f;
+            for (int k = 0; k < modes; ++k)
+            {
+                total += w[k][x];
+            }
+            for (int k = 0; k < modes; ++k)
+            {
+                w[k][x] /= total;
+            }
+
+            // only the updated mode may change its place in the order
+            for (int k = matched; k > 0 && w[k][x] * w[k][x] / var[k][x] > w[k - 1][x] * w[k - 1][x] / var[k - 1][x]; --k)
+            {
+                std::swap(w[k][x], w[k - 1][x]);
+                std::swap(var[k][x], var[k - 1][x]);
+                for (int c = 0; c < cn_; ++c)
+                {
+                    std::swap(mu[k][e + c], mu[k - 1][e + c]);
+                }
+            }
+        }
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        const float* mu = planes_[2 * modes].ptr<float>(y);
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            dst[e] = cv::saturate_cast<uchar>(mu[e]);
+        }
+    }
+
+    private:
+    static constexpr int modes = 3;
+    static constexpr float background_ratio = 0.7f;
+    static constexpr float init_var = 15.0f * 15.0f;
+    static constexpr float min_var = 4.0f * 4.0f;
+    static constexpr float max_var = 75.0f * 75.0f;
+};
+
+constexpr int gmm::modes;
+constexpr float gmm::background_ratio;
+constexpr float gmm::init_var;
+constexpr float gmm::min_var;
+constexpr float gmm::max_var;
+
+/// \brief Fills rnd with n (multiple of 4) xorshift32 numbers, 4 generators run in parallel lanes
+void xorshift_fill(unsigned seed, unsigned* rnd, int n)
+{
+    unsigned state[4];
+    for (unsigned lane = 0; lane < 4; ++lane)
+    {
+        // murmur3 finalizer spreads neighbouring seeds over the whole state space
+        unsigned h = seed + lane * 0x9E3779B9u;
+        h = (h ^ (h >> 16)) * 0x85EBCA6Bu;
+        h = (h ^ (h >> 13)) * 0xC2B2AE35u;
+        h ^= h >> 16;
+        state[lane] = h ? h : 1;
+    }
+
+    int i = 0;
+#if CV_SIMD128
+    cv::v_uint32x4 s = cv::v_load(state);
+    for (; i < n; i += 4)
+    {
+        s = s ^ (s << 13);
+        s = s ^ (s >> 17);
+        s = s ^ (s << 5);
+        cv::v_store(rnd + i, s);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        unsigned& x = state[i & 3];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        rnd[i] = x;
+    }
+}
+
+/// \brief flags[i] = 255 when |a[i] - b[i]| > radius
+void mismatch_flags(const uchar* a, const uchar* b, uchar* flags, int n, int radius)
+{
+    int i = 0;
+#if CV_SIMD128
+    const cv::v_uint8x16 vr = cv::v_setall_u8(static_cast<uchar>(radius));
+    for (; i <= n - 16; i += 16)
+    {
+        cv::v_store(flags + i, cv::v_absdiff(cv::v_load(a + i), cv::v_load(b + i)) > vr);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        flags[i] = std::abs(a[i] - b[i]) > radius ? 255 : 0;
+    }
+}
+
+/// \brief matches[i] += 1 when mismatch[i] is not set
+void count_matches(const uchar* mismatch, uchar* matches, int n)
+{
+    int i = 0;
+#if CV_SIMD128
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    const cv::v_uint8x16 one = cv::v_setall_u8(1);
+    for (; i <= n - 16; i += 16)
+    {
+        cv::v_store(matches + i, cv::v_load(matches + i) + ((cv::v_load(mismatch + i) == zero) & one));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        matches[i] += mismatch[i] ? 0 : 1;
+    }
+}
+
+/// \brief Offsets of 8 neighbours of a pixel
+const int neighbour_dx[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+const int neighbour_dy[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+/// \brief Sample-based model (ViBe): pixel is background when it is close to at least min_matches of its samples
+///        Samples are kept in planes, one per sample index, so matching against one sample is a contiguous SIMD pass.
+///        Background pixels replace a random sample of their own with probability rate and, independently, a random
+///        sample of a random one of 8 neighbours with probability rate. Neighbours may belong to rows of other threads,
+///        so their updates are queued per source row and applied once the whole frame is processed.
+///        Random numbers depend on frame, row and chunk only, so results do not depend on tiling
+class vibe : public background_model
+{
+    public:
+    vibe(const cv::Mat& background) : background_model(background)
+    {
+        for (int k = 0; k < samples; ++k)
+        {
+            add_plane(CV_8U, background);
+        }
+        pending_.resize(background.rows);
+        processed_.resize(background.rows);
+    }
+
+    void next_frame() override
+    {
+        ++frames_;
+    }
+
+    void end_frame(std::vector<cv::Point>& updated) override
+    {
+        // only pixels processed in this frame are updated, the ones outside ROI or in skipped blocks are left intact
+        for (auto& row : pending_)
+        {
+            for (const auto& d : row)
+            {
+                const auto& spans = processed_[d.y];
+                const bool inside = std::any_of(spans.begin(), spans.end(), [&](const cv::Range& span) { return span.start <= d.x && d.x < span.end; });
+                if (!inside)
+                    continue;
+                std::copy(d.value, d.value + cn_, planes_[d.sample].ptr<uchar>(d.y) + d.x * cn_);
+                updated.emplace_back(d.x, d.y);
+            }
+            row.clear();
+        }
+        for (auto& spans : processed_)
+        {
+            spans.clear();
+        }
+    }
+
+    std::vector<double> scalars() const override
+    {
+        return {threshold_, static_cast<double>(frames_)};
+    }
+
+    void set_scalars(const std::vector<double>& values) override
+    {
+        CV_Assert(values.size() == 2);
+        background_model::set_scalars(values);
+        frames_ = static_cast<unsigned>(values[1]);
+    }
+
+    void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) override
+    {
+        const int chunk = 256;
+        uchar flags[chunk * 4];
+        uchar mismatch[chunk];
+        uchar matches[chunk];
+        unsigned rnd[chunk * 2];
+
+        processed_[y].emplace_back(x_begin, x_end);
+        const int radius = std::min(std::max(cvFloor(threshold_), 0), 255);
+        // update happens when 16 random bits are below rate in Q16
+        const unsigned update = static_cast<unsigned>(std::min(std::max(rate, 0.0f), 1.0f) * 65536.0f);
+        uchar* sample[samples];
+        for (int k = 0; k < samples; ++k)
+        {
+            sample[k] = planes_[k].ptr<uchar>(y);
+        }
+
+        for (int x = x_begin; x < x_end; x += chunk)
+        {
+            const int n = std::min(chunk, x_end - x);
+            const uchar* s = src + x * cn_;
+            std::fill(matches, matches + n, 0);
+            for (int k = 0; k < samples; ++k)
+            {
+                if (cn_ == 1)
+                {
+                    mismatch_flags(s, sample[k] + x, mismatch, n, radius);
+                }
+                else
+                {
+                    mismatch_flags(s, sample[k] + x * cn_, flags, n * cn_, radius);
+                    cvlib::reduce_channels(flags, mismatch, n, cn_);
+                }
+                count_matches(mismatch, matches, n);
+            }
+
+            // random bits of the first word: 0-15 update, 16-19 sample, 20-23 neighbour sample, 24-26 neighbour;
+            // the second word decides neighbour update
+            xorshift_fill(frames_ * 0x2545F491u ^ static_cast<unsigned>(y) * 0x9E3779B1u ^ static_cast<unsigned>(x), rnd, 2 * ((n + 3) & ~3));
+            for (int i = 0; i < n; ++i)
+            {
+                mask[x + i] = matches[i] < min_matches ? 255 : 0;
+                if (mask[x + i])
+                {
+                    continue;
+                }
+
+                const unsigned r = rnd[2 * i];
+                const uchar* value = s + i * cn_;
+                if ((r & 0xFFFF) < update)
+                {
+                    std::copy(value, value + cn_, sample[(r >> 16) & (samples - 1)] + (x + i) * cn_);
+                }
+                if ((rnd[2 * i + 1] & 0xFFFF) < update)
+                {
+                    const int nx = x + i + neighbour_dx[(r >> 24) & 7];
+                    const int ny = y + neighbour_dy[(r >> 24) & 7];
+                    if (nx >= 0 && nx < size_.width && ny >= 0 && ny < size_.height)
+                    {
+                        diffusion d = {nx, ny, static_cast<int>((r >> 20) & (samples - 1)), {}};
+                        std::copy(value, value + cn_, d.value);
+                        pending_[y].push_back(d);
+                    }
+                }
+            }
+        }
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        // mean of samples
+        for (int e = x_begin * cn_; e < x_end * cn_; ++e)
+        {
+            int sum = samples / 2;
+            for (int k = 0; k < samples; ++k)
+            {
+                sum += planes_[k].ptr<uchar>(y)[e];
+            }
+            dst[e] = static_cast<uchar>(sum / samples);
+        }
+    }
+
+    private:
+    static constexpr int samples = 16; ///< power of two, index is taken from random bits
+    static constexpr int min_matches = 2;
+
+    /// \brief Sample of a neighbour to be replaced with the value of a background pixel
+    struct diffusion
+    {
+        int x;
+        int y;
+        int sample;
+        uchar value[4];
+    };
+
+    unsigned frames_ = 0;
+    std::vector<std::vector<diffusion>> pending_; ///< by source row, every row is processed by one thread
+    std::vector<std::vector<cv::Range>> processed_; ///< spans passed to process_row in this frame, by row
+};
+
+constexpr int vibe::samples;
+constexpr int vibe::min_matches;
+
+/// \brief Codebook model with fixed number of codewords per pixel
+///        Codeword is a box of channel bounds with hit counter and frame of last hit, each field of each codeword
+///        is a separate plane. Pixel matching a codeword hit at least 1 / rate times is background;
+///        unmatched pixel replaces the least recently hit codeword when rate is positive.
+///        Codewords still below background hit count after stale_frames without hits (e.g. left by passing objects)
+///        are dropped by a pruning pass every prune_period frames, so they do not occupy slots of the pixel
+class codebook : public background_model
+{
+    public:
+    codebook(const cv::Mat& background) : background_model(background)
+    {
+        add_plane(CV_8U, background);
+        for (int k = 1; k < codewords; ++k)
+        {
+            add_plane(CV_8U);
+        }
+        add_plane(CV_8U, background);
+        for (int k = 1; k < codewords; ++k)
+        {
+            add_plane(CV_8U);
+        }
+        add_plane(CV_16U, false).setTo(max_hits);
+        for (int k = 1; k < codewords; ++k)
+        {
+            add_plane(CV_16U, false);
+        }
+        for (int k = 0; k < codewords; ++k)
+        {
+            add_plane(CV_16U, false);
+        }
+    }
+
+    void next_frame() override
+    {
+        ++frames_;
+    }
+
+    std::vector<double> scalars() const override
+    {
+        return {threshold_, static_cast<double>(frames_)};
+    }
+
+    void set_scalars(const std::vector<double>& values) override
+    {
+        CV_Assert(values.size() == 2);
+        background_model::set_scalars(values);
+        frames_ = static_cast<unsigned>(values[1]);
+    }
+
+    void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) override
+    {
+        const int thr = std::min(std::max(cvFloor(threshold_), 0), 255);
+        const int min_hits = rate > 0 ? std::min(cvCeil(1 / rate), static_cast<int>(max_hits)) : max_hits;
+        const ushort now = static_cast<ushort>(frames_);
+        const bool prune = frames_ % prune_period == 0;
+
+        uchar* lo[codewords];
+        uchar* hi[codewords];
+        ushort* hits[codewords];
+        ushort* last[codewords];
+        for (int k = 0; k < codewords; ++k)
+        {
+            lo[k] = planes_[k].ptr<uchar>(y);
+            hi[k] = planes_[codewords + k].ptr<uchar>(y);
+            hits[k] = planes_[2 * codewords + k].ptr<ushort>(y);
+            last[k] = planes_[3 * codewords + k].ptr<ushort>(y);
+        }
+
+        for (int x = x_begin; x < x_end; ++x)
+        {
+            const uchar* s = src + x * cn_;
+            const int e = x * cn_;
+            int match = -1;
+            for (int k = 0; k < codewords && match < 0; ++k)
+            {
+                bool inside = hits[k][x] > 0;
+                for (int c = 0; c < cn_ && inside; ++c)
+                {
+                    inside = lo[k][e + c] - thr <= s[c] && s[c] <= hi[k][e + c] + thr;
+                }
+                match = inside ? k : -1;
+            }
+
+            if (match >= 0)
+            {
+                mask[x] = hits[match][x] < min_hits ? 255 : 0;
+                update(lo[match] + e, hi[match] + e, s, thr);
+                hits[match][x] = static_cast<ushort>(std::min(hits[match][x] + 1, static_cast<int>(max_hits)));
+                last[match][x] = now;
+            }
+            else
+            {
+                mask[x] = 255;
+                if (rate > 0)
+                {
+                    // empty codeword or the least recently hit one
+                    int victim = 0;
+                    int oldest = -1;
+                    for (int k = 0; k < codewords; ++k)
+                    {
+                        const int age = hits[k][x] ? static_cast<ushort>(now - last[k][x]) : 65536;
+                        if (age > oldest)
+                        {
+                            oldest = age;
+                            victim = k;
+                        }
+                    }
+                    std::copy(s, s + cn_, lo[victim] + e);
+                    std::copy(s, s + cn_, hi[victim] + e);
+                    hits[victim][x] = 1;
+                    last[victim][x] = now;
+                }
+            }
+
+            if (prune)
+            {
+                for (int k = 0; k < codewords; ++k)
+                {
+                    if (hits[k][x] < min_hits && static_cast<ushort>(now - last[k][x]) > stale_frames)
+                        hits[k][x] = 0;
+                }
+            }
+        }
+    }
+
+    void background_row(int y, uchar* dst, int x_begin, int x_end) const override
+    {
+        // center of the most hit codeword
+        for (int x = x_begin; x < x_end; ++x)
+        {
+            int best = 0;
+            for (int k = 1; k < codewords; ++k)
+            {
+                if (planes_[2 * codewords + k].ptr<ushort>(y)[x] > planes_[2 * codewords + best].ptr<ushort>(y)[x])
+                    best = k;
+            }
+            const uchar* lo = planes_[best].ptr<uchar>(y);
+            const uchar* hi = planes_[codewords + best].ptr<uchar>(y);
+            for (int e = x * cn_; e < (x + 1) * cn_; ++e)
+            {
+                dst[e] = static_cast<uchar>((lo[e] + hi[e] + 1) >> 1);
+            }
+        }
+    }
+
+    private:
+    /// \brief Extends bounds to cover value, the bound far from it follows the value when box gets wider than thr
+    void update(uchar* lo, uchar* hi, const uchar* s, int thr) const
+    {
+        for (int c = 0; c < cn_; ++c)
+        {
+            lo[c] = static_cast<uchar>(std::max(std::min<int>(lo[c], s[c]), s[c] - thr));
+            hi[c] = static_cast<uchar>(std::min(std::max<int>(hi[c], s[c]), s[c] + thr));
+        }
+    }
+
+    static constexpr int codewords = 4;
+    static constexpr ushort max_hits = 65535;
+    static constexpr unsigned prune_period = 64;
+    static constexpr int stale_frames = 1024; ///< below 65536 - prune_period, so 16-bit ages do not wrap unnoticed
+
+    unsigned frames_ = 0;
+};
+
+constexpr int codebook::codewords;
+constexpr ushort codebook::max_hits;
+constexpr unsigned codebook::prune_period;
+constexpr int codebook::stale_frames;
+} // namespace
+
+namespace cvlib
+{
+// static
+cv::Ptr<background_model> background_model::create(motion_segmentation::model_type type, const cv::Mat& background)
+{
+    cv::Ptr<background_model> model;
+    switch (type)
+    {
+        case motion_segmentation::model_type::running_average:
+            model = cv::makePtr<running_average>(background);
+            break;
+        case motion_segmentation::model_type::min_max:
+            model = cv::makePtr<min_max>(background);
+            break;
+        case motion_segmentation::model_type::mean:
+            model = cv::makePtr<mean>(background);
+            break;
+        case motion_segmentation::model_type::gaussian:
+            model = cv::makePtr<gaussian>(background);
+            break;
+        case motion_segmentation::model_type::gmm:
+            model = cv::makePtr<gmm>(background);
+            break;
+        case motion_segmentation::model_type::running_average_fixed:
+            model = cv::makePtr<running_average_fixed>(background);
+            break;
+        case motion_segmentation::model_type::vibe:
+            model = cv::makePtr<vibe>(background);
+            break;
+        case motion_segmentation::model_type::codebook:
+            model = cv::makePtr<codebook>(background);
+            break;
+        default:
+            CV_Error(cv::Error::StsBadArg, "unknown background model");
+    }
+    model->type_ = type;
+    return model;
+}
+
+void elementwise_model::process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate)
+{
+    // flags of a chunk stay in L1 cache between classification and channel reduction
+    const int chunk = 256;
+    uchar flags[chunk * 4];
+    for (int x = x_begin; x < x_end; x += chunk)
+    {
+        const int n = std::min(chunk, x_end - x);
+        process_elements(y, src, flags, x * cn_, (x + n) * cn_, rate);
+        reduce_channels(flags, mask + x, n, cn_);
+    }
+}
+
+void reduce_channels(const uchar* flags, uchar* mask, int n, int cn)
+{
+    if (cn == 1)
+    {
+        std::copy(flags, flags + n, mask);
+        return;
+    }
+
+    int x = 0;
+#if CV_SIMD128
+    if (cn == 3)
+    {
+        for (; x <= n - 16; x += 16)
+        {
+            cv::v_uint8x16 a;
+            cv::v_uint8x16 b;
+            cv::v_uint8x16 c;
+            cv::v_load_deinterleave(flags + 3 * x, a, b, c);
+            cv::v_store(mask + x, a | b | c);
+        }
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        uchar any = 0;
+        for (int c = 0; c < cn; ++c)
+        {
+            any |= flags[x * cn + c];
+        }
+        mask[x] = any;
+    }
+}
+} // namespace cvlib
@@ -0,0 +1,154 @@
+/* Background models for motion segmentation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#ifndef __BACKGROUND_MODEL_HPP__
+#define __BACKGROUND_MODEL_HPP__
+
+#include "cvlib.hpp"
+
+namespace cvlib
+{
+/// \brief Per-pixel background model processed row by row
+///        All per-pixel state is kept in planes: one continuous matrix per parameter,
+///        element-wise parameters have rows x (cols * channels) layout, the same as 8-bit input rows
+class background_model
+{
+    public:
+    /// \brief Creates model of passed type initialized by background image
+    static cv::Ptr<background_model> create(motion_segmentation::model_type type, const cv::Mat& background);
+
+    virtual ~background_model() = default;
+
+    /// \brief Called once per frame before its rows are processed
+    virtual void next_frame()
+    {
+    }
+
+    /// \brief Called once per frame after all its rows are processed
+    /// \param updated, out - pixels whose background is changed by the call are appended
+    virtual void end_frame(std::vector<cv::Point>& updated)
+    {
+        (void)updated;
+    }
+
+    /// \brief Classifies pixels [x_begin, x_end) of row y and updates the model
+    /// \param src, in - row of the input image
+    /// \param mask, out - row of 1-channel mask, 255 for foreground
+    /// \param rate, in - learning rate
+    virtual void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) = 0;
+
+    /// \brief Writes background estimate of pixels [x_begin, x_end) of row y
+    virtual void background_row(int y, uchar* dst, int x_begin, int x_end) const = 0;
+
+    /// \brief Sets threshold of intensity difference used by the model
+    void set_threshold(float threshold)
+    {
+        threshold_ = threshold;
+    }
+
+    float threshold() const
+    {
+        return threshold_;
+    }
+
+    cv::Size size() const
+    {
+        return size_;
+    }
+
+    int channels() const
+    {
+        return cn_;
+    }
+
+    motion_segmentation::model_type type() const
+    {
+        return type_;
+    }
+
+    /// \brief Planes with the whole per-pixel state, replaced by snapshot loading
+    std::vector<cv::Mat>& planes()
+    {
+        return planes_;
+    }
+
+    /// \brief Scalar state besides planes, threshold goes first
+    virtual std::vector<double> scalars() const
+    {
+        return {threshold_};
+    }
+
+    /// \brief Restores scalar state returned by scalars()
+    virtual void set_scalars(const std::vector<double>& values)
+    {
+        CV_Assert(!values.empty());
+        threshold_ = static_cast<float>(values[0]);
+    }
+
+    /// \brief Switches per-pixel learning rate depending on how long pixel stays background
+    virtual void set_adaptive_rate(bool enabled)
+    {
+        if (enabled)
+            CV_Error(cv::Error::StsNotImplemented, "adaptive learning rate is not supported by the model");
+    }
+
+    /// \brief Keeps memory planes point to (e.g. mapped snapshot file) alive with the model
+    void keep_alive(std::shared_ptr<uchar> storage)
+    {
+        storage_ = std::move(storage);
+    }
+
+    protected:
+    background_model(const cv::Mat& background) : size_(background.size()), cn_(background.channels())
+    {
+        CV_Assert(background.depth() == CV_8U && cn_ <= 4);
+    }
+
+    /// \brief Adds zero plane of passed depth, element-wise planes have cols * channels columns
+    cv::Mat& add_plane(int depth, bool elementwise = true)
+    {
+        planes_.emplace_back(cv::Mat::zeros(size_.height, size_.width * (elementwise ? cn_ : 1), depth));
+        return planes_.back();
+    }
+
+    /// \brief Adds element-wise plane of passed depth filled with background values
+    cv::Mat& add_plane(int depth, const cv::Mat& background)
+    {
+        planes_.emplace_back();
+        background.clone().reshape(1, size_.height).convertTo(planes_.back(), depth);
+        return planes_.back();
+    }
+
+    cv::Size size_;
+    int cn_;
+    float threshold_ = 25.0f;
+    std::vector<cv::Mat> planes_;
+
+    private:
+    motion_segmentation::model_type type_ = motion_segmentation::model_type::running_average;
+    std::shared_ptr<uchar> storage_;
+};
+
+/// \brief Base for models which classify each channel independently,
+///        pixel is foreground when any of its channels is foreground
+class elementwise_model : public background_model
+{
+    public:
+    void process_row(int y, const uchar* src, uchar* mask, int x_begin, int x_end, float rate) override;
+
+    protected:
+    using background_model::background_model;
+
+    /// \brief Classifies elements [begin, end) of row y and updates the model
+    /// \param flags, out - 0 or 255 for each element, flags[0] corresponds to the element begin
+    virtual void process_elements(int y, const uchar* src, uchar* flags, int begin, int end, float rate) = 0;
+};
+
+/// \brief mask[x] = 255 when any of cn flags of pixel x is set
+void reduce_channels(const uchar* flags, uchar* mask, int n, int cn);
+} // namespace cvlib
+
+#endif // __BACKGROUND_MODEL_HPP__
@@ -6,79 +6,258 @@
 
 #include "cvlib.hpp"
 
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
 #include <ctime>
 
 namespace cvlib
 {
 // static
-cv::Ptr<corner_detector_fast> corner_detector_fast::create()
+cv::Ptr<corner_detector_fast> corner_detector_fast::create(int threshold /*= 30*/, detector_type type /*= detector_type::fast_12*/)
+{
+    auto detector = cv::makePtr<corner_detector_fast>();
+    detector->set_threshold(threshold);
+    detector->set_type(type);
+    return detector;
+}
+
+void corner_detector_fast::set_threshold(int threshold)
 {
-    return cv::makePtr<corner_detector_fast>();
+    CV_Assert(threshold >= 0 && threshold < 255);
+    threshold_ = threshold;
 }
 
-bool test_candidate(const cv::Mat& img, cv::Point point, const std::vector<cv::Point>& offsets, int pixel_num_threshold)
+void corner_detector_fast::set_type(detector_type type)
+{
+    CV_Assert(type == detector_type::fast_9 || type == detector_type::fast_10 || type == detector_type::fast_12);
+    type_ = type;
+}
+
+namespace
+{
+/// \brief Bresenham circle of radius 3, clockwise from the top
+constexpr int circle_x[16] = {0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+constexpr int circle_y[16] = {-3, -3, -2, -1, 0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3};
+
+/// \brief Offsets of circle pixels from the center in bytes
+struct circle_table
+{
+    int offsets[16];
+};
+
+/// \brief Circle offsets for row step in bytes, the inner loop adds them to the center pointer
+constexpr circle_table make_circle_table(int step)
 {
-    int count_a = 0;
-    int count_b = 0;
-    int sz = offsets.size();
-    const int threshold = 30;
-    const auto pixel = img.at<uint8_t>(point);
-    for (int i = 0; i < 2 * sz; ++i)
+    circle_table table = {};
+    for (int k = 0; k < 16; ++k)
     {
-        int normed_iter = i % sz;
-        const auto offset_pixel = img.at<uint8_t>(point + offsets[normed_iter]);
-        if (offset_pixel < pixel - threshold) {
-            ++count_a;
-            count_b = 0;
-        }
-        if (offset_pixel > pixel + threshold) {
-            ++count_b;
-            count_a = 0;
-        }
-        if (count_a >= pixel_num_threshold || count_b >= pixel_num_threshold) return true;
+        table.offsets[k] = circle_y[k] * step + circle_x[k];
+    }
+    return table;
+}
+
+/// \brief Segment test of single center
+/// \tparam N - number of contiguous circle pixels which all are brighter or all are darker than the center
+/// \param offsets, in - offsets of circle pixels from the center in bytes
+template <int N>
+bool segment_test(const uchar* p, const int* offsets, int threshold)
+{
+    const int v = *p;
+    int bright = 0;
+    int dark = 0;
+    for (int k = 0; k < 16 + N - 1; ++k)
+    {
+        const int c = p[offsets[k & 15]];
+        bright = c > v + threshold ? bright + 1 : 0;
+        dark = c < v - threshold ? dark + 1 : 0;
+        if (bright >= N || dark >= N)
+            return true;
     }
     return false;
 }
 
-void corner_detector_fast::detect(cv::InputArray image, CV_OUT std::vector<cv::KeyPoint>& keypoints, cv::InputArray /*mask = cv::noArray()*/)
+/// \brief FAST score of the corner: maximum threshold for which the segment test still passes
+/// \param threshold, in - threshold for which the center already passes the test
+template <int N>
+int corner_score(const uchar* p, const int* offsets, int threshold)
 {
-    keypoints.clear();
-    const auto img_ = image.getMat();
-    cv::Mat img;
-    img_.copyTo(img);
-    if (img.channels() == 3)
-        cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
-
-    // точки для проверки, представленные как смещения от тестируемой точки
-    // первая группа пикселей (крест) проверяется в начале, если предикат не выполнен, процедура завершается
-    // если выполнен, проверяются оставшиеся пиксели
-    const auto offsets_init = std::vector<cv::Point>{
-        cv::Point(0, 3), 
-        cv::Point(3, 0), 
-        cv::Point( 0, -3), 
-        cv::Point(-3, 0)
-        };
-    const auto offsets_residual = std::vector<cv::Point>{
-        cv::Point(-1, 3), cv::Point(1, 3),
-        cv::Point(2, 2), 
-        cv::Point(3, 1), cv::Point(3, -1), 
-        cv::Point(2, -2),
-        cv::Point(1, -3), cv::Point(-1, -3),
-        cv::Point(-2, -2),
-        cv::Point(-3, -1), cv::Point(-3, 1),
-        cv::Point(-2, 2)
-        };
+    // the test passes for all thresholds up to the score, so it is found by bisection
+    int low = threshold;
+    int high = 255;
+    while (low < high)
+    {
+        const int mid = (low + high + 1) / 2;
+        if (segment_test<N>(p, offsets, mid))
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+#if CV_SIMD128
+/// \brief Early rejection of 16 neighbouring centers by few circle pixels
+///        Arc of 9 or 10 pixels can not miss both ends of a diameter, so every pair of opposite pixels
+///        has one brighter (darker) than the center
+/// \param v, in - centers
+/// \return 0xFF in lanes which may be corners
+template <int N>
+cv::v_uint8x16 pretest(const uchar* p, const int* offsets, const cv::v_uint8x16& v, const cv::v_uint8x16& threshold)
+{
+    cv::v_uint8x16 bright_pairs = cv::v_setall_u8(0xFF);
+    cv::v_uint8x16 dark_pairs = cv::v_setall_u8(0xFF);
+    for (int k = 0; k < 8; k += 2)
+    {
+        const cv::v_uint8x16 c0 = cv::v_load(p + offsets[k]);
+        const cv::v_uint8x16 c1 = cv::v_load(p + offsets[k + 8]);
+        bright_pairs &= ((c0 - v) > threshold) | ((c1 - v) > threshold);
+        dark_pairs &= ((v - c0) > threshold) | ((v - c1) > threshold);
+    }
+    return bright_pairs | dark_pairs;
+}
+
+/// \brief Early rejection for arc of 12, which covers at least 3 of 4 compass points
+template <>
+cv::v_uint8x16 pretest<12>(const uchar* p, const int* offsets, const cv::v_uint8x16& v, const cv::v_uint8x16& threshold)
+{
+    cv::v_uint8x16 bright_cross = cv::v_setzero_u8();
+    cv::v_uint8x16 dark_cross = cv::v_setzero_u8();
+    for (int k = 0; k < 16; k += 4)
+    {
+        const cv::v_uint8x16 c = cv::v_load(p + offsets[k]);
+        bright_cross = cv::v_sub_wrap(bright_cross, (c - v) > threshold);
+        dark_cross = cv::v_sub_wrap(dark_cross, (v - c) > threshold);
+    }
+    const cv::v_uint8x16 min_cross = cv::v_setall_u8(3);
+    return (bright_cross >= min_cross) | (dark_cross >= min_cross);
+}
+
+/// \brief Segment test of 16 neighbouring centers p[0], ..., p[15]
+/// \return 0xFF in lanes of corners
+template <int N>
+cv::v_uint8x16 segment_test_16(const uchar* p, const int* offsets, const cv::v_uint8x16& threshold)
+{
+    const cv::v_uint8x16 v = cv::v_load(p);
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    const cv::v_uint8x16 one = cv::v_setall_u8(1);
+
+    // saturating differences: c - v > t for brighter, v - c > t for darker pixels
+    const cv::v_uint8x16 candidates = pretest<N>(p, offsets, v, threshold);
+    if (!cv::v_check_any(candidates))
+        return zero;
+
+    // run counters restart at every pixel not passing the test, the arc may wrap around
+    cv::v_uint8x16 bright = zero;
+    cv::v_uint8x16 dark = zero;
+    cv::v_uint8x16 bright_max = zero;
+    cv::v_uint8x16 dark_max = zero;
+    for (int k = 0; k < 16 + N - 1; ++k)
+    {
+        const cv::v_uint8x16 c = cv::v_load(p + offsets[k & 15]);
+        bright = (bright + one) & ((c - v) > threshold);
+        dark = (dark + one) & ((v - c) > threshold);
+        bright_max = cv::v_max(bright_max, bright);
+        dark_max = cv::v_max(dark_max, dark);
+    }
+    const cv::v_uint8x16 arc = cv::v_setall_u8(N);
+    return candidates & ((bright_max >= arc) | (dark_max >= arc));
+}
+#endif
+
+/// \brief FAST-N corners of grayscale image
+/// \param nonmax_suppression, in - keeps only corners with maximum score in 3x3 neighbourhood
+template <int N>
+void detect_corners(const cv::Mat& img, int threshold, bool nonmax_suppression, std::vector<cv::KeyPoint>& keypoints)
+{
+    const circle_table circle = make_circle_table(static_cast<int>(img.step));
+    const int* offsets = circle.offsets;
+
+    // scores of three last rows, zero for non-corners; a row is suppressed once the row below it is scored
+    const int cols = img.cols;
+    std::vector<uchar> scores(3 * cols, 0);
+    std::vector<int> corners[3];
+    auto emit_row = [&](int row) {
+        const uchar* above = &scores[(row + 2) % 3 * cols];
+        const uchar* curr = &scores[row % 3 * cols];
+        const uchar* below = &scores[(row + 1) % 3 * cols];
+        for (int col : corners[row % 3])
+        {
+            const uchar s = curr[col];
+            if (!nonmax_suppression || (s > curr[col - 1] && s > curr[col + 1] && s > above[col - 1] && s > above[col] && s > above[col + 1] &&
+                                         s > below[col - 1] && s > below[col] && s > below[col + 1]))
+                keypoints.push_back(cv::KeyPoint(cv::Point2f(static_cast<float>(col), static_cast<float>(row)), 3, -1, s));
+        }
+    };
 
     // крайние 3 ряда пикселей не обрабатываются, т.к. окно не помещается на изображении
-    for (auto row = 3; row < img.rows - 3; ++row)
+    for (int row = 3; row < img.rows - 3; ++row)
     {
-        for (auto col = 3; col < img.cols - 3; ++col)
+        const uchar* ptr = img.ptr<uchar>(row);
+        uchar* row_scores = &scores[row % 3 * cols];
+        std::fill(row_scores, row_scores + cols, uchar(0));
+        std::vector<int>& row_corners = corners[row % 3];
+        row_corners.clear();
+
+        int col = 3;
+#if CV_SIMD128
+        const cv::v_uint8x16 vthreshold = cv::v_setall_u8(static_cast<uchar>(threshold));
+        for (; col <= img.cols - 3 - 16; col += 16)
         {
-            const auto center = cv::Point(col, row);
-            if (test_candidate(img, center, offsets_init, 3) && test_candidate(img, center, offsets_residual, 12)) {
-                keypoints.push_back(cv::KeyPoint(center, 3));
+            int mask = cv::v_signmask(segment_test_16<N>(ptr + col, offsets, vthreshold));
+            for (int i = 0; mask; ++i, mask >>= 1)
+            {
+                if (mask & 1)
+                    row_corners.push_back(col + i);
             }
         }
+#endif
+        for (; col < img.cols - 3; ++col)
+        {
+            if (segment_test<N>(ptr + col, offsets, threshold))
+                row_corners.push_back(col);
+        }
+
+        // only passing pixels are scored
+        for (int c : row_corners)
+            row_scores[c] = static_cast<uchar>(corner_score<N>(ptr + c, offsets, threshold));
+
+        if (row > 3)
+            emit_row(row - 1);
+    }
+
+    // the last row has no corners below it
+    const int last = img.rows - 4;
+    if (last >= 3)
+    {
+        std::fill_n(&scores[(last + 1) % 3 * cols], cols, uchar(0));
+        emit_row(last);
+    }
+}
+} // namespace
+
+void corner_detector_fast::detect(cv::InputArray image, CV_OUT std::vector<cv::KeyPoint>& keypoints, cv::InputArray /*mask = cv::noArray()*/)
+{
+    keypoints.clear();
+    const cv::Mat src = image.getMat();
+    CV_Assert(src.depth() == CV_8U);
+
+    // grayscale input is read in place
+    cv::Mat img = src;
+    if (src.channels() != 1)
+        cv::cvtColor(src, img, cv::COLOR_BGR2GRAY);
+
+    switch (type_)
+    {
+        case detector_type::fast_9:
+            detect_corners<9>(img, threshold_, nonmax_suppression_, keypoints);
+            break;
+        case detector_type::fast_10:
+            detect_corners<10>(img, threshold_, nonmax_suppression_, keypoints);
+            break;
+        case detector_type::fast_12:
+            detect_corners<12>(img, threshold_, nonmax_suppression_, keypoints);
+            break;
     }
 }
 
@@ -0,0 +1,143 @@
+/* Compact mask formats implementation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include "mask_codec.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace cvlib
+{
+void pack_row(const uchar* mask, uchar* packed, int cols)
+{
+    int x = 0;
+#if CV_SIMD128
+    // sign bits of 16 flags are exactly two packed bytes, any nonzero value is foreground
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    for (; x <= cols - 16; x += 16)
+    {
+        const int bits = cv::v_signmask(cv::v_load(mask + x) != zero);
+        packed[x / 8] = static_cast<uchar>(bits);
+        packed[x / 8 + 1] = static_cast<uchar>(bits >> 8);
+    }
+#endif
+    for (; x < cols; x += 8)
+    {
+        uchar byte = 0;
+        for (int i = 0; i < 8 && x + i < cols; ++i)
+        {
+            byte |= mask[x + i] ? 1 << i : 0;
+        }
+        packed[x / 8] = byte;
+    }
+}
+
+void extract_runs(const uchar* mask, int cols, std::vector<mask_run>& runs)
+{
+    runs.clear();
+    for (int x = 0; x < cols; ++x)
+    {
+        if (!mask[x])
+            continue;
+        const int begin = x;
+        while (x < cols && mask[x])
+            ++x;
+        runs.push_back({begin, x});
+    }
+}
+
+void write_rle(const std::vector<std::vector<mask_run>>& row_runs, int cols, cv::OutputArray _rle)
+{
+    size_t length = 2 + row_runs.size();
+    for (const auto& runs : row_runs)
+        length += 2 * runs.size();
+
+    _rle.create(1, static_cast<int>(length), CV_32SC1);
+    int* rle = _rle.getMat().ptr<int>();
+    *rle++ = static_cast<int>(row_runs.size());
+    *rle++ = cols;
+    for (const auto& runs : row_runs)
+    {
+        *rle++ = static_cast<int>(runs.size());
+        for (const auto& run : runs)
+        {
+            *rle++ = run.begin;
+            *rle++ = run.end;
+        }
+    }
+}
+
+void pack_mask(const cv::Mat& mask, cv::Mat& packed)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+    packed.create(mask.rows, (mask.cols + 7) / 8, CV_8UC1);
+    for (int y = 0; y < mask.rows; ++y)
+        pack_row(mask.ptr<uchar>(y), packed.ptr<uchar>(y), mask.cols);
+}
+
+void unpack_mask(const cv::Mat& packed, int cols, cv::Mat& mask)
+{
+    CV_Assert(packed.type() == CV_8UC1 && packed.cols == (cols + 7) / 8);
+    mask.create(packed.rows, cols, CV_8UC1);
+    for (int y = 0; y < packed.rows; ++y)
+    {
+        const uchar* src = packed.ptr<uchar>(y);
+        uchar* dst = mask.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x)
+            dst[x] = (src[x / 8] >> (x % 8)) & 1 ? 255 : 0;
+    }
+}
+
+void packed_and(const cv::Mat& a, const cv::Mat& b, cv::Mat& dst)
+{
+    CV_Assert(a.type() == CV_8UC1 && a.size() == b.size() && a.type() == b.type());
+    cv::bitwise_and(a, b, dst);
+}
+
+void packed_or(const cv::Mat& a, const cv::Mat& b, cv::Mat& dst)
+{
+    CV_Assert(a.type() == CV_8UC1 && a.size() == b.size() && a.type() == b.type());
+    cv::bitwise_or(a, b, dst);
+}
+
+int packed_count(const cv::Mat& packed)
+{
+    CV_Assert(packed.type() == CV_8UC1);
+    // hamming norm is the vectorized popcount of OpenCV
+    return static_cast<int>(cv::norm(packed, cv::NORM_HAMMING));
+}
+
+void encode_rle(const cv::Mat& mask, cv::Mat& rle)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+    std::vector<std::vector<mask_run>> row_runs(mask.rows);
+    for (int y = 0; y < mask.rows; ++y)
+        extract_runs(mask.ptr<uchar>(y), mask.cols, row_runs[y]);
+    write_rle(row_runs, mask.cols, rle);
+}
+
+void decode_rle(const cv::Mat& rle, cv::Mat& mask)
+{
+    CV_Assert(rle.type() == CV_32SC1 && rle.rows == 1 && rle.cols >= 2);
+    const int* src = rle.ptr<int>();
+    const int* end = src + rle.cols;
+    const int rows = *src++;
+    const int cols = *src++;
+    mask.create(rows, cols, CV_8UC1);
+    mask.setTo(0);
+    for (int y = 0; y < rows; ++y)
+    {
+        CV_Assert(src < end);
+        const int runs = *src++;
+        CV_Assert(runs >= 0 && end - src >= 2 * runs);
+        uchar* dst = mask.ptr<uchar>(y);
+        for (int r = 0; r < runs; ++r, src += 2)
+        {
+            CV_Assert(0 <= src[0] && src[0] <= src[1] && src[1] <= cols);
+            std::fill(dst + src[0], dst + src[1], 255);
+        }
+    }
+}
+} // namespace cvlib
@@ -0,0 +1,24 @@
+/* Row-level helpers of compact mask formats.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#ifndef __MASK_CODEC_HPP__
+#define __MASK_CODEC_HPP__
+
+#include "cvlib.hpp"
+
+namespace cvlib
+{
+/// \brief Packs cols byte flags of mask row into (cols + 7) / 8 bytes, pixel x is bit x % 8 of byte x / 8
+void pack_row(const uchar* mask, uchar* packed, int cols);
+
+/// \brief Replaces runs by runs of foreground pixels of mask row
+void extract_runs(const uchar* mask, int cols, std::vector<mask_run>& runs);
+
+/// \brief Writes runs of all rows in RLE format, see encode_rle
+void write_rle(const std::vector<std::vector<mask_run>>& row_runs, int cols, cv::OutputArray rle);
+} // namespace cvlib
+
+#endif // __MASK_CODEC_HPP__
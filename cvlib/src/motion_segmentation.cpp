@@ -1,47 +1,502 @@
-/* Split and merge segmentation algorithm implementation.
+/* Motion segmentation algorithm implementation.
  * @file
  * @date 2018-09-18
  * @author Anonymous
  */
 
 #include "cvlib.hpp"
-#include <iostream>
+
+#include "background_model.hpp"
+#include "mask_codec.hpp"
 
 namespace cvlib
 {
-Buffer::Buffer(size_t buff_size) : _buffer(buff_size) {}
+Buffer::Buffer(size_t buff_size) : _capacity(buff_size) {
+    CV_Assert(buff_size > 0);
+}
+
+void Buffer::allocate(const cv::Mat& frame) {
+    const size_t alignment = 64;
+    const size_t row_step = cv::alignSize(frame.cols * frame.elemSize(), alignment);
+    const size_t slot_size = row_step * frame.rows;
 
-void Buffer::push_back(cv::Mat frame) {
-    _buffer.push_back(frame);
+    // slots start zeroed, so subtracting the "evicted" frame is correct before buffer is full
+    _storage.assign(slot_size * _capacity + alignment, 0);
+    uchar* base = cv::alignPtr(_storage.data(), alignment);
+    _slots.clear();
+    for (size_t i = 0; i < _capacity; ++i)
+        _slots.emplace_back(frame.rows, frame.cols, frame.type(), base + i * slot_size, row_step);
+
+    _sum = cv::Mat(frame.size(), CV_32SC(frame.channels()), cv::Scalar::all(0));
+    _size = 0;
+    _head = 0;
 }
 
-cv::Mat Buffer::get_mean() {
-    cv::Mat mean = cv::Mat(_buffer.front().size(), CV_32FC3, cv::Scalar());
-    for (auto& frame : _buffer)
-        cv::accumulate(frame, mean);
-    mean.convertTo(mean, CV_8UC3, 1.0 / _buffer.size());
+void Buffer::push_back(const cv::Mat& frame) {
+    CV_Assert(frame.depth() == CV_8U);
+    if (_slots.empty() || frame.size() != _slots[0].size() || frame.type() != _slots[0].type())
+        allocate(frame);
+
+    // running sum gets the new frame and loses the evicted one while the frame is copied into its slot
+    cv::Mat& slot = _slots[_head];
+    const int width = frame.cols * frame.channels();
+    for (int y = 0; y < frame.rows; ++y)
+    {
+        int* sum = _sum.ptr<int>(y);
+        const uchar* added = frame.ptr<uchar>(y);
+        uchar* stored = slot.ptr<uchar>(y);
+        for (int x = 0; x < width; ++x)
+        {
+            sum[x] += added[x] - stored[x];
+            stored[x] = added[x];
+        }
+    }
+
+    _head = (_head + 1) % _capacity;
+    _size = std::min(_size + 1, _capacity);
+}
+
+cv::Mat Buffer::get_mean() const {
+    cv::Mat mean;
+    get_mean(mean);
     return mean;
 }
 
-motion_segmentation::motion_segmentation(cv::Mat bg) : bg_model_(bg) {}
+void Buffer::get_mean(cv::Mat& mean) const {
+    CV_Assert(_size > 0);
+    _sum.convertTo(mean, CV_8U, 1.0 / _size);
+}
+
+const cv::Mat& Buffer::operator[](size_t idx) const {
+    CV_Assert(idx < _size);
+    return _slots[(_head + _capacity - _size + idx) % _capacity];
+}
+
+constexpr double motion_segmentation::default_learning_rate;
+
+namespace
+{
+cv::Size scaled_size(const cv::Size& size, int factor)
+{
+    return cv::Size(std::max(1, size.width / factor), std::max(1, size.height / factor));
+}
+
+/// \brief Calls fn(begin, end) for every nonempty intersection of [begin, end) with ROI spans of the row,
+///        the whole range is passed when there is no ROI
+template <typename Fn>
+void for_each_roi_span(const std::vector<cvlib::mask_run>* roi, int begin, int end, Fn fn)
+{
+    if (!roi)
+    {
+        fn(begin, end);
+        return;
+    }
+    for (const auto& span : *roi)
+    {
+        const int b = std::max(begin, span.begin);
+        const int e = std::min(end, span.end);
+        if (b < e)
+            fn(b, e);
+    }
+}
+} // namespace
+
+motion_segmentation::motion_segmentation(cv::Mat bg, model_type type) : model_(background_model::create(type, bg)), frame_size_(bg.size()) {}
 
 void motion_segmentation::apply(cv::InputArray _image, cv::OutputArray _fgmask, double learning_rate)
 {
-    // \todo implement your own algorithm:
-    //       * MinMax
-    //       * Mean
-    //       * 1G
-    //       * GMM
-    cv::Mat image = _image.getMat();
-    cv::Mat fgmask = _fgmask.getMat();
-
-    // \todo implement bg model updates
-    bg_model_ = (1 - learning_rate) * bg_model_ + learning_rate * image;
-    cv::absdiff(image, bg_model_, fgmask);
-    threshold(fgmask, fgmask, 25, 128, cv::THRESH_BINARY);
-    cv::cvtColor(fgmask, fgmask, cv::COLOR_BGR2GRAY);
-
-    _fgmask.create(image.size(), CV_8UC3);
-    _fgmask.assign(fgmask);
+    const cv::Mat image = _image.getMat();
+    CV_Assert(image.depth() == CV_8U && scaled_size(image.size(), scale_) == model_->size() && image.channels() == model_->channels());
+
+    // compact formats are produced from 8-bit rows right after they are classified
+    cv::Mat fgmask;
+    if (mask_format_ == mask_format::bytes)
+    {
+        _fgmask.create(image.size(), CV_8UC1);
+        fgmask = _fgmask.getMat();
+    }
+    else
+    {
+        byte_mask_.create(image.size(), CV_8UC1);
+        fgmask = byte_mask_;
+    }
+    cv::Mat packed;
+    if (mask_format_ == mask_format::bits)
+    {
+        _fgmask.create(image.rows, (image.cols + 7) / 8, CV_8UC1);
+        packed = _fgmask.getMat();
+    }
+
+    const float rate = static_cast<float>(learning_rate < 0 ? default_learning_rate : learning_rate);
+    if (scale_ == 1)
+    {
+        collect_runs_ = blob_output_ || mask_format_ == mask_format::rle;
+        packed_ = packed;
+        segment(image, fgmask, rate);
+    }
+    else
+    {
+        // model works on area-downsampled frame, its mask is upsampled back
+        collect_runs_ = false;
+        cv::resize(image, small_frame_, model_->size(), 0, 0, cv::INTER_AREA);
+        small_mask_.create(model_->size(), CV_8UC1);
+        segment(small_frame_, small_mask_, rate);
+        cv::resize(small_mask_, fgmask, image.size(), 0, 0, cv::INTER_NEAREST);
+        if (refine_edges_)
+            refine_edges(image, fgmask);
+        if (!roi_.empty())
+            cv::bitwise_and(fgmask, roi_, fgmask);
+
+        // runs and blobs are taken from the final full-resolution mask, so they follow refined edges and ROI
+        collect_runs_ = blob_output_ || mask_format_ == mask_format::rle;
+        packed_ = packed;
+        row_runs_.resize(collect_runs_ ? image.rows : 0);
+        if (collect_runs_ || !packed_.empty())
+        {
+            cv::parallel_for_(cv::Range(0, image.rows),
+                              [&](const cv::Range& rows) {
+                                  for (int y = rows.start; y < rows.end; ++y)
+                                      emit_row(fgmask, y);
+                              },
+                              std::max(1, image.rows / min_tile_rows_));
+        }
+        label_runs();
+    }
+
+    if (mask_format_ == mask_format::rle)
+        write_rle(row_runs_, image.cols, _fgmask);
+    packed_.release();
+}
+
+void motion_segmentation::segment(const cv::Mat& image, cv::Mat& fgmask, float rate)
+{
+    model_->next_frame();
+    row_runs_.resize(collect_runs_ ? image.rows : 0);
+
+    if (block_size_ > 0)
+    {
+        process_blocks(image, fgmask, rate);
+    }
+    else
+    {
+        // rows are independent, so tiles of rows are spread over the OpenCV thread pool
+        const int tiles = std::max(1, image.rows / min_tile_rows_);
+        cv::parallel_for_(cv::Range(0, image.rows),
+                          [&](const cv::Range& rows) {
+                              for (int y = rows.start; y < rows.end; ++y)
+                              {
+                                  uchar* mask = fgmask.ptr<uchar>(y);
+                                  const auto* roi = roi_row(y);
+                                  if (roi)
+                                      std::fill(mask, mask + image.cols, 0);
+                                  for_each_roi_span(roi, 0, image.cols, [&](int begin, int end) {
+                                      model_->process_row(y, image.ptr<uchar>(y), mask, begin, end, rate);
+                                  });
+                                  emit_row(fgmask, y);
+                              }
+                          },
+                          tiles);
+    }
+    std::vector<cv::Point> updated;
+    model_->end_frame(updated);
+    if (block_size_ > 0)
+    {
+        // processed pixels changed after their background was cached
+        for (const auto& p : updated)
+        {
+            model_->background_row(p.y, block_background_.ptr<uchar>(p.y), p.x, p.x + 1);
+        }
+    }
+
+    label_runs();
+}
+
+void motion_segmentation::refine_edges(const cv::Mat& image, cv::Mat& fgmask)
+{
+    // only pixels of low-resolution cells with mixed neighbourhood are reclassified
+    cv::Mat grown;
+    cv::Mat shrunk;
+    cv::dilate(small_mask_, grown, cv::Mat());
+    cv::erode(small_mask_, shrunk, cv::Mat());
+    getBackgroundImage(small_background_);
+
+    const int cn = image.channels();
+    const int thr = cvFloor(model_->threshold());
+    const int tiles = std::max(1, image.rows / min_tile_rows_);
+
+    // the same mapping of pixels to cells as cv::resize with INTER_NEAREST uses for upsampling,
+    // computed the same way, so rounding matches as well
+    const double fx = 1.0 / (static_cast<double>(image.cols) / small_mask_.cols);
+    const double fy = 1.0 / (static_cast<double>(image.rows) / small_mask_.rows);
+    std::vector<int> cell_x(image.cols);
+    for (int x = 0; x < image.cols; ++x)
+        cell_x[x] = std::min(cvFloor(x * fx), small_mask_.cols - 1);
+    cv::parallel_for_(cv::Range(0, image.rows),
+                      [&](const cv::Range& rows) {
+                          for (int y = rows.start; y < rows.end; ++y)
+                          {
+                              const int sy = std::min(cvFloor(y * fy), small_mask_.rows - 1);
+                              const uchar* g = grown.ptr<uchar>(sy);
+                              const uchar* e = shrunk.ptr<uchar>(sy);
+                              const uchar* bg = small_background_.ptr<uchar>(sy);
+                              const uchar* src = image.ptr<uchar>(y);
+                              uchar* mask = fgmask.ptr<uchar>(y);
+                              for (int x = 0; x < image.cols; ++x)
+                              {
+                                  const int sx = cell_x[x];
+                                  if (g[sx] == e[sx])
+                                      continue;
+                                  bool foreground = false;
+                                  for (int c = 0; c < cn; ++c)
+                                      foreground |= std::abs(src[x * cn + c] - bg[sx * cn + c]) > thr;
+                                  mask[x] = foreground ? 255 : 0;
+                              }
+                          }
+                      },
+                      tiles);
+}
+
+void motion_segmentation::process_blocks(const cv::Mat& image, cv::Mat& fgmask, float rate)
+{
+    if (block_background_.empty())
+        getBackgroundImage(block_background_);
+
+    // background of skipped blocks is not updated, so the cached image stays valid for them
+    const int bands = (image.rows + block_size_ - 1) / block_size_;
+    const int blocks = (image.cols + block_size_ - 1) / block_size_;
+    const int tiles = std::max(1, image.rows / std::max(min_tile_rows_, block_size_));
+    cv::parallel_for_(cv::Range(0, bands),
+                      [&](const cv::Range& range) {
+                          std::vector<cv::Range> spans;
+                          for (int band = range.start; band < range.end; ++band)
+                          {
+                              const int y_begin = band * block_size_;
+                              const int y_end = std::min(y_begin + block_size_, image.rows);
+
+                              // neighbouring changed blocks are merged into spans processed row by row
+                              spans.clear();
+                              for (int block = 0; block < blocks; ++block)
+                              {
+                                  const cv::Rect rect(block * block_size_, y_begin, std::min(block_size_, image.cols - block * block_size_), y_end - y_begin);
+                                  const double floor = noise_floor_ * rect.area() * image.channels();
+                                  if (!roi_covers(rect) || cv::norm(image(rect), block_background_(rect), cv::NORM_L1) < floor)
+                                      fgmask(rect).setTo(0);
+                                  else if (!spans.empty() && spans.back().end == rect.x)
+                                      spans.back().end = rect.x + rect.width;
+                                  else
+                                      spans.emplace_back(rect.x, rect.x + rect.width);
+                              }
+
+                              for (int y = y_begin; y < y_end; ++y)
+                              {
+                                  uchar* mask = fgmask.ptr<uchar>(y);
+                                  const auto* roi = roi_row(y);
+                                  for (const auto& span : spans)
+                                  {
+                                      if (roi)
+                                          std::fill(mask + span.start, mask + span.end, 0);
+                                      for_each_roi_span(roi, span.start, span.end, [&](int begin, int end) {
+                                          model_->process_row(y, image.ptr<uchar>(y), mask, begin, end, rate);
+                                          model_->background_row(y, block_background_.ptr<uchar>(y), begin, end);
+                                      });
+                                  }
+                                  emit_row(fgmask, y);
+                              }
+                          }
+                      },
+                      tiles);
+}
+
+bool motion_segmentation::roi_covers(const cv::Rect& rect) const
+{
+    if (roi_spans_.empty())
+        return true;
+    for (int y = rect.y; y < rect.y + rect.height; ++y)
+    {
+        for (const auto& span : roi_spans_[y])
+        {
+            if (span.begin < rect.x + rect.width && rect.x < span.end)
+                return true;
+        }
+    }
+    return false;
+}
+
+void motion_segmentation::update_roi_spans()
+{
+    roi_spans_.clear();
+    if (roi_.empty())
+        return;
+    if (roi_.size() != frame_size_)
+    {
+        // frame size was redefined by a snapshot
+        roi_.release();
+        return;
+    }
+
+    // cells of processing scale partially inside ROI are processed
+    cv::Mat roi = roi_;
+    if (scale_ > 1)
+        cv::resize(roi_, roi, model_->size(), 0, 0, cv::INTER_AREA);
+    roi_spans_.resize(roi.rows);
+    for (int y = 0; y < roi.rows; ++y)
+        extract_runs(roi.ptr<uchar>(y), roi.cols, roi_spans_[y]);
+}
+
+void motion_segmentation::emit_row(const cv::Mat& fgmask, int y)
+{
+    // the row is still in cache right after the model produced it
+    if (collect_runs_)
+        extract_runs(fgmask.ptr<uchar>(y), fgmask.cols, row_runs_[y]);
+    if (!packed_.empty())
+        pack_row(fgmask.ptr<uchar>(y), packed_.ptr<uchar>(y), fgmask.cols);
+}
+
+namespace
+{
+int find_root(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+} // namespace
+
+void motion_segmentation::label_runs()
+{
+    blobs_.clear();
+    if (!blob_output_)
+        return;
+
+    std::vector<int> first(row_runs_.size() + 1, 0);
+    for (size_t y = 0; y < row_runs_.size(); ++y)
+        first[y + 1] = first[y] + static_cast<int>(row_runs_[y].size());
+
+    // runs of neighbouring rows touching at least diagonally belong to one blob
+    std::vector<int> parent(first.back());
+    for (int i = 0; i < first.back(); ++i)
+        parent[i] = i;
+    for (size_t y = 1; y < row_runs_.size(); ++y)
+    {
+        const auto& above = row_runs_[y - 1];
+        const auto& current = row_runs_[y];
+        size_t a = 0;
+        size_t c = 0;
+        while (a < above.size() && c < current.size())
+        {
+            if (above[a].begin <= current[c].end && current[c].begin <= above[a].end)
+            {
+                const int ra = find_root(parent, first[y - 1] + static_cast<int>(a));
+                const int rc = find_root(parent, first[y] + static_cast<int>(c));
+                parent[std::max(ra, rc)] = std::min(ra, rc);
+            }
+            if (above[a].end < current[c].end)
+                ++a;
+            else
+                ++c;
+        }
+    }
+
+    // statistics are accumulated in the root runs, blobs are ordered by their topmost run
+    std::vector<int> index(parent.size(), -1);
+    std::vector<cv::Point2d> sums;
+    for (size_t y = 0; y < row_runs_.size(); ++y)
+    {
+        for (size_t r = 0; r < row_runs_[y].size(); ++r)
+        {
+            const mask_run& run = row_runs_[y][r];
+            const int root = find_root(parent, first[y] + static_cast<int>(r));
+            if (index[root] < 0)
+            {
+                index[root] = static_cast<int>(blobs_.size());
+                blobs_.emplace_back();
+                blobs_.back().bbox = cv::Rect(run.begin, static_cast<int>(y), run.end - run.begin, 1);
+                sums.emplace_back(0, 0);
+            }
+            blob& b = blobs_[index[root]];
+            const int length = run.end - run.begin;
+            b.bbox |= cv::Rect(run.begin, static_cast<int>(y), length, 1);
+            b.area += length;
+            sums[index[root]] += cv::Point2d(0.5 * (run.begin + run.end - 1) * length, static_cast<double>(y) * length);
+        }
+    }
+    for (size_t i = 0; i < blobs_.size(); ++i)
+        blobs_[i].centroid = sums[i] * (1.0 / blobs_[i].area);
+}
+
+void motion_segmentation::getBackgroundImage(cv::OutputArray _background) const
+{
+    _background.create(model_->size(), CV_8UC(model_->channels()));
+    cv::Mat background = _background.getMat();
+    for (int y = 0; y < background.rows; ++y)
+    {
+        model_->background_row(y, background.ptr<uchar>(y), 0, background.cols);
+    }
+}
+
+void motion_segmentation::set_threshold(double threshold)
+{
+    model_->set_threshold(static_cast<float>(threshold));
+}
+
+void motion_segmentation::set_adaptive_rate(bool enabled)
+{
+    model_->set_adaptive_rate(enabled);
+}
+
+void motion_segmentation::set_min_tile_rows(int rows)
+{
+    CV_Assert(rows > 0);
+    min_tile_rows_ = rows;
+}
+
+void motion_segmentation::set_block_gating(int block_size, double noise_floor)
+{
+    CV_Assert(block_size >= 0 && noise_floor >= 0);
+    block_size_ = block_size;
+    noise_floor_ = noise_floor;
+    block_background_.release();
+}
+
+void motion_segmentation::set_mask_format(mask_format format)
+{
+    mask_format_ = format;
+}
+
+void motion_segmentation::set_blob_output(bool enabled)
+{
+    blob_output_ = enabled;
+    blobs_.clear();
+}
+
+void motion_segmentation::set_processing_scale(int factor, bool refine_edges)
+{
+    CV_Assert(factor >= 1);
+    refine_edges_ = refine_edges;
+    if (factor == scale_)
+        return;
+
+    cv::Mat background;
+    getBackgroundImage(background);
+    cv::resize(background, background, scaled_size(frame_size_, factor), 0, 0, cv::INTER_AREA);
+    const auto scalars = model_->scalars();
+    model_ = background_model::create(model_->type(), background);
+    model_->set_scalars(scalars);
+    scale_ = factor;
+    block_background_.release();
+    update_roi_spans();
+}
+
+void motion_segmentation::set_roi(const cv::Mat& roi)
+{
+    CV_Assert(roi.empty() || (roi.type() == CV_8UC1 && roi.size() == frame_size_));
+    if (roi.empty())
+        roi_.release();
+    else
+        cv::compare(roi, 0, roi_, cv::CMP_NE);
+    update_roi_spans();
 }
 } // namespace cvlib
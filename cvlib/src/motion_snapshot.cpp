@@ -0,0 +1,187 @@
+/* Snapshots of motion segmentation models.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include "cvlib.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "background_model.hpp"
+
+namespace
+{
+const char snapshot_magic[8] = {'C', 'V', 'L', 'I', 'B', 'B', 'G', 'M'};
+const uint32_t snapshot_version = 2; ///< 2 adds adaptive rate flag to scalars of running_average
+const size_t plane_alignment = 64; ///< planes start at aligned file offsets, so mapped planes are aligned too
+
+/// \brief File layout: header, scalars (double), plane headers, aligned plane data
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    int32_t type;
+    int32_t rows;
+    int32_t cols;
+    int32_t channels;
+    uint32_t scalars;
+    uint32_t planes;
+    uint32_t reserved;
+};
+
+struct plane_header
+{
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint32_t reserved;
+    uint64_t offset; ///< offset of plane data from the file begin
+};
+
+/// \brief Maps whole file into memory with private copy-on-write pages
+std::shared_ptr<uchar> map_file(const std::string& path, size_t& size)
+{
+#ifdef _WIN32
+    // no mmap, the file is read into memory
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        CV_Error(cv::Error::StsError, "cannot open snapshot " + path);
+    size = static_cast<size_t>(in.tellg());
+    std::shared_ptr<uchar> data(new uchar[size], std::default_delete<uchar[]>());
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(data.get()), size))
+        CV_Error(cv::Error::StsError, "cannot read snapshot " + path);
+    return data;
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        CV_Error(cv::Error::StsError, "cannot open snapshot " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        CV_Error(cv::Error::StsError, "cannot read snapshot " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        CV_Error(cv::Error::StsError, "cannot map snapshot " + path);
+    return std::shared_ptr<uchar>(static_cast<uchar*>(addr), [size](uchar* p) { munmap(p, size); });
+#endif
+}
+} // namespace
+
+namespace cvlib
+{
+motion_segmentation::model_type motion_segmentation::type() const
+{
+    return model_->type();
+}
+
+void motion_segmentation::save(const std::string& path) const
+{
+    const auto& planes = model_->planes();
+    const auto scalars = model_->scalars();
+
+    snapshot_header header = {};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.type = static_cast<int32_t>(model_->type());
+    header.rows = model_->size().height;
+    header.cols = model_->size().width;
+    header.channels = model_->channels();
+    header.scalars = static_cast<uint32_t>(scalars.size());
+    header.planes = static_cast<uint32_t>(planes.size());
+
+    std::vector<plane_header> headers(planes.size());
+    size_t offset = cv::alignSize(sizeof(header) + scalars.size() * sizeof(double) + headers.size() * sizeof(plane_header), plane_alignment);
+    for (size_t i = 0; i < planes.size(); ++i)
+    {
+        CV_Assert(planes[i].isContinuous());
+        headers[i] = {planes[i].rows, planes[i].cols, planes[i].type(), 0, offset};
+        offset = cv::alignSize(offset + planes[i].total() * planes[i].elemSize(), plane_alignment);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(scalars.data()), scalars.size() * sizeof(double));
+    out.write(reinterpret_cast<const char*>(headers.data()), headers.size() * sizeof(plane_header));
+    size_t written = sizeof(header) + scalars.size() * sizeof(double) + headers.size() * sizeof(plane_header);
+    const char padding[plane_alignment] = {};
+    for (size_t i = 0; i < planes.size(); ++i)
+    {
+        out.write(padding, headers[i].offset - written);
+        const size_t bytes = planes[i].total() * planes[i].elemSize();
+        out.write(reinterpret_cast<const char*>(planes[i].data), bytes);
+        written = headers[i].offset + bytes;
+    }
+    if (!out)
+        CV_Error(cv::Error::StsError, "cannot write snapshot " + path);
+}
+
+void motion_segmentation::load(const std::string& path)
+{
+    size_t size = 0;
+    const std::shared_ptr<uchar> file = map_file(path, size);
+    const uchar* data = file.get();
+
+    snapshot_header header;
+    if (size < sizeof(header))
+        CV_Error(cv::Error::StsParseError, "truncated snapshot " + path);
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0)
+        CV_Error(cv::Error::StsParseError, "not a background model snapshot " + path);
+    if (header.version < 1 || header.version > snapshot_version)
+        CV_Error(cv::Error::StsParseError, "unsupported snapshot version " + std::to_string(header.version));
+
+    size_t pos = sizeof(header);
+    if (size < pos + header.scalars * sizeof(double) + header.planes * sizeof(plane_header))
+        CV_Error(cv::Error::StsParseError, "truncated snapshot " + path);
+    std::vector<double> scalars(header.scalars);
+    std::memcpy(scalars.data(), data + pos, scalars.size() * sizeof(double));
+    pos += scalars.size() * sizeof(double);
+    std::vector<plane_header> headers(header.planes);
+    std::memcpy(headers.data(), data + pos, headers.size() * sizeof(plane_header));
+    if (header.version == 1 && static_cast<model_type>(header.type) == model_type::running_average && scalars.size() == 1)
+        scalars.push_back(0); // adaptive rate did not exist yet
+
+    // model of the same type and scalar state defines the expected planes
+    const cv::Mat shape(header.rows, header.cols, CV_8UC(header.channels), cv::Scalar::all(0));
+    auto model = background_model::create(static_cast<model_type>(header.type), shape);
+    model->set_scalars(scalars);
+    auto& planes = model->planes();
+    if (planes.size() != headers.size())
+        CV_Error(cv::Error::StsParseError, "snapshot does not match the model " + path);
+    for (size_t i = 0; i < planes.size(); ++i)
+    {
+        const plane_header& h = headers[i];
+        if (h.rows != planes[i].rows || h.cols != planes[i].cols || h.type != planes[i].type() || h.offset % plane_alignment != 0 ||
+            h.offset + planes[i].total() * planes[i].elemSize() > size)
+            CV_Error(cv::Error::StsParseError, "snapshot does not match the model " + path);
+        planes[i] = cv::Mat(h.rows, h.cols, h.type, file.get() + h.offset);
+    }
+    model->keep_alive(file);
+
+    model_ = model;
+    block_background_.release();
+
+    // snapshot of other frame size or processing scale defines the frame size
+    if (cv::Size(std::max(1, frame_size_.width / scale_), std::max(1, frame_size_.height / scale_)) != model_->size())
+    {
+        scale_ = 1;
+        frame_size_ = model_->size();
+    }
+    update_roi_spans();
+}
+} // namespace cvlib
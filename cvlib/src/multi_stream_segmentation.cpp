@@ -0,0 +1,82 @@
+/* Multi-stream background subtraction implementation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include "cvlib.hpp"
+
+namespace cvlib
+{
+int multi_stream_segmentation::add_stream(const cv::Mat& background, motion_segmentation::model_type type)
+{
+    streams_.emplace_back(new stream(background, type));
+    return static_cast<int>(streams_.size()) - 1;
+}
+
+void multi_stream_segmentation::submit(int idx, const cv::Mat& frame)
+{
+    stream& s = *streams_.at(idx);
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (s.has_pending)
+        ++s.stats.dropped;
+    frame.copyTo(s.pending);
+    s.pending_ticks = cv::getTickCount();
+    s.has_pending = true;
+}
+
+int multi_stream_segmentation::process_batch(double learning_rate)
+{
+    // pending frames are swapped out under the lock, so submit never waits for processing
+    std::vector<stream*> batch;
+    for (auto& s : streams_)
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        if (!s->has_pending)
+            continue;
+        std::swap(s->frame, s->pending);
+        s->frame_ticks = s->pending_ticks;
+        s->has_pending = false;
+        batch.push_back(s.get());
+    }
+
+    // streams are the tasks of the pool, nested parallel_for_ of apply runs inline in the worker
+    cv::parallel_for_(cv::Range(0, static_cast<int>(batch.size())),
+                      [&](const cv::Range& range) {
+                          for (int i = range.start; i < range.end; ++i)
+                          {
+                              stream& s = *batch[i];
+                              s.segmentation.apply(s.frame, s.result, learning_rate);
+
+                              const double latency = (cv::getTickCount() - s.frame_ticks) * 1000.0 / cv::getTickFrequency();
+                              std::lock_guard<std::mutex> guard(s.lock);
+                              std::swap(s.mask, s.result);
+                              ++s.stats.processed;
+                              s.stats.last_latency_ms = latency;
+                              s.stats.mean_latency_ms += (latency - s.stats.mean_latency_ms) / s.stats.processed;
+                          }
+                      },
+                      static_cast<double>(batch.size()));
+
+    return static_cast<int>(batch.size());
+}
+
+motion_segmentation& multi_stream_segmentation::segmentation(int idx)
+{
+    return streams_.at(idx)->segmentation;
+}
+
+cv::Mat multi_stream_segmentation::mask(int idx) const
+{
+    const stream& s = *streams_.at(idx);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.mask.clone();
+}
+
+multi_stream_segmentation::stream_stats multi_stream_segmentation::stats(int idx) const
+{
+    const stream& s = *streams_.at(idx);
+    std::lock_guard<std::mutex> guard(s.lock);
+    return s.stats;
+}
+} // namespace cvlib
@@ -0,0 +1,58 @@
+/* Latency budget scheduler of motion segmentation implementation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include "cvlib.hpp"
+
+#include <cmath>
+
+namespace cvlib
+{
+segmentation_scheduler::segmentation_scheduler(motion_segmentation& segmentation, double latency_ms) : segmentation_(segmentation)
+{
+    set_latency(latency_ms);
+}
+
+bool segmentation_scheduler::process(const cv::Mat& frame, cv::OutputArray fgmask, double learning_rate, int64 capture_ticks)
+{
+    const double ms_per_tick = 1000.0 / cv::getTickFrequency();
+    const int64 start = cv::getTickCount();
+    const double waited_ms = capture_ticks ? (start - capture_ticks) * ms_per_tick : 0.0;
+
+    if (waited_ms + processing_ms_ > latency_ms_ && skipped_in_row_ < max_skipped_)
+    {
+        ++skipped_in_row_;
+        ++skipped_;
+        return false;
+    }
+
+    // for exponential blend one step of the processed frame replaces steps of the skipped ones,
+    // rates of other models are not blend weights, so they are passed unchanged
+    const auto type = segmentation_.type();
+    const bool blend = type == motion_segmentation::model_type::running_average || type == motion_segmentation::model_type::running_average_fixed ||
+                       type == motion_segmentation::model_type::gaussian;
+    const double rate = learning_rate < 0 ? motion_segmentation::default_learning_rate : learning_rate;
+    segmentation_.apply(frame, fgmask, blend ? 1.0 - std::pow(1.0 - std::min(rate, 1.0), skipped_in_row_ + 1) : learning_rate);
+    skipped_in_row_ = 0;
+
+    const double elapsed_ms = (cv::getTickCount() - start) * ms_per_tick;
+    const double smoothing = 0.1;
+    processing_ms_ = processed_ ? processing_ms_ + smoothing * (elapsed_ms - processing_ms_) : elapsed_ms;
+    ++processed_;
+    return true;
+}
+
+void segmentation_scheduler::set_latency(double latency_ms)
+{
+    CV_Assert(latency_ms > 0);
+    latency_ms_ = latency_ms;
+}
+
+void segmentation_scheduler::set_max_skipped(int frames)
+{
+    CV_Assert(frames >= 0);
+    max_skipped_ = frames;
+}
+} // namespace cvlib
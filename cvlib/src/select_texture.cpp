@@ -6,64 +6,180 @@
 
 #include "cvlib.hpp"
 
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <climits>
+#include <limits>
+
 namespace
 {
-struct descriptor : public std::vector<double>
+int round_to_odd(double d) {
+    // corner cases
+    if (d >= std::numeric_limits<int>::max()) return std::numeric_limits<int>::max();
+    if (d <= std::numeric_limits<int>::min()) return std::numeric_limits<int>::min() + 1;
+    
+    bool negative = d < 0;
+    int truncated = negative ? -d : d; 
+    if (truncated % 2 == 0) 
+        ++truncated; 
+
+    return negative ? -truncated : truncated;
+}
+
+
+/// \brief Gabor kernel quantized to int16 for filtering of 8-bit images
+///        Rows are padded with zero weight to even length, so taps are accumulated in pairs
+struct quantized_kernel
+{
+    int size = 0; // kernel is size x size
+    int step = 0; // weights per row, size rounded up to even
+    float inv_scale = 0.0f; // response = accumulator * inv_scale
+    std::vector<short> weights; // size x step
+    std::vector<int> pairs; // neighbour weights packed as (w[2i], w[2i + 1]) for dot products
+};
+
+quantized_kernel quantize_kernel(const cv::Mat& kernel)
 {
-    using std::vector<double>::vector;
-    descriptor operator-(const descriptor& right) const
+    CV_Assert(kernel.rows == kernel.cols && kernel.type() == CV_64F);
+
+    quantized_kernel q;
+    q.size = kernel.rows;
+    q.step = (q.size + 1) & ~1;
+
+    // the largest scale which keeps weights in int16 and sum of products with 8-bit pixels in int32
+    // (rounding adds at most 0.5 per tap to the sum of absolute weights)
+    const double max_abs = cv::norm(kernel, cv::NORM_INF);
+    const double sum_abs = cv::norm(kernel, cv::NORM_L1);
+    const double taps = static_cast<double>(q.size) * q.size;
+    const double scale = max_abs > 0 ? std::min(SHRT_MAX / max_abs, (INT_MAX / 255.0 - 0.5 * taps) / sum_abs) : 1.0;
+    q.inv_scale = static_cast<float>(1.0 / scale);
+
+    q.weights.assign(q.size * q.step, 0);
+    for (int ky = 0; ky < q.size; ++ky)
     {
-        descriptor temp = *this;
-        for (size_t i = 0; i < temp.size(); ++i)
+        for (int kx = 0; kx < q.size; ++kx)
         {
-            temp[i] -= right[i];
+            q.weights[ky * q.step + kx] = cv::saturate_cast<short>(kernel.at<double>(ky, kx) * scale);
         }
-        return temp;
     }
 
-    double norm_l1() const
+    q.pairs.resize(q.weights.size() / 2);
+    for (size_t i = 0; i < q.pairs.size(); ++i)
     {
-        double res = 0.0;
-        for (auto v : *this)
-        {
-            res += std::abs(v);
-        }
-        return res;
+        const auto lo = static_cast<unsigned short>(q.weights[2 * i]);
+        const auto hi = static_cast<unsigned short>(q.weights[2 * i + 1]);
+        q.pairs[i] = static_cast<int>(lo | (static_cast<unsigned>(hi) << 16));
     }
+    return q;
+}
 
-    double norm_l2() const
+/// \brief Correlates 8-bit image with quantized kernel, same as cv::filter2D with CV_32F output
+void correlate_quantized(const cv::Mat& image, const quantized_kernel& kernel, cv::Mat& response, int border)
+{
+    CV_Assert(image.type() == CV_8UC1);
+
+    const int r = kernel.size / 2;
+    cv::Mat padded;
+    // one more column on the right lets the last pair of taps read past the kernel width
+    cv::copyMakeBorder(image, padded, r, r, r, r + 1, border);
+    response.create(image.size(), CV_32F);
+
+    for (int y = 0; y < image.rows; ++y)
     {
-        double res = 0.0;
-        for (auto v : *this)
+        float* dst = response.ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        const cv::v_float32x4 inv_scale = cv::v_setall_f32(kernel.inv_scale);
+        for (; x <= image.cols - 8; x += 8)
         {
-            res += v*v;
+            cv::v_int32x4 acc_lo = cv::v_setzero_s32();
+            cv::v_int32x4 acc_hi = cv::v_setzero_s32();
+            for (int ky = 0; ky < kernel.size; ++ky)
+            {
+                const uchar* src = padded.ptr<uchar>(y + ky) + x;
+                const int* pairs = &kernel.pairs[ky * kernel.step / 2];
+                for (int kx = 0; kx < kernel.size; kx += 2)
+                {
+                    const cv::v_int16x8 a = cv::v_reinterpret_as_s16(cv::v_load_expand(src + kx));
+                    const cv::v_int16x8 b = cv::v_reinterpret_as_s16(cv::v_load_expand(src + kx + 1));
+                    cv::v_int16x8 ab_lo;
+                    cv::v_int16x8 ab_hi;
+                    cv::v_zip(a, b, ab_lo, ab_hi);
+                    const cv::v_int16x8 w = cv::v_reinterpret_as_s16(cv::v_setall_s32(pairs[kx / 2]));
+                    acc_lo += cv::v_dotprod(ab_lo, w);
+                    acc_hi += cv::v_dotprod(ab_hi, w);
+                }
+            }
+            cv::v_store(dst + x, cv::v_cvt_f32(acc_lo) * inv_scale);
+            cv::v_store(dst + x + 4, cv::v_cvt_f32(acc_hi) * inv_scale);
+        }
+#endif
+        for (; x < image.cols; ++x)
+        {
+            int acc = 0;
+            for (int ky = 0; ky < kernel.size; ++ky)
+            {
+                const uchar* src = padded.ptr<uchar>(y + ky) + x;
+                const short* w = &kernel.weights[ky * kernel.step];
+                for (int kx = 0; kx < kernel.size; ++kx)
+                {
+                    acc += src[kx] * w[kx];
+                }
+            }
+            dst[x] = acc * kernel.inv_scale;
         }
-        return res;
     }
-};
+}
 
+/// \brief Best of several timings of the call in ticks, the others are disturbed by caches and scheduling
+template <typename F>
+int64 best_ticks(F f)
+{
+    int64 best = std::numeric_limits<int64>::max();
+    for (int run = 0; run < 3; ++run)
+    {
+        const int64 start = cv::getTickCount();
+        f();
+        best = std::min(best, cv::getTickCount() - start);
+    }
+    return best;
+}
 
-int round_to_odd(double d) {
-    // corner cases
-    if (d >= std::numeric_limits<int>::max()) return std::numeric_limits<int>::max();
-    if (d <= std::numeric_limits<int>::min()) return std::numeric_limits<int>::min() + 1;
-    
-    bool negative = d < 0;
-    int truncated = negative ? -d : d; 
-    if (truncated % 2 == 0) 
-        ++truncated; 
+/// \brief Largest kernel size for which correlate_quantized is faster than cv::filter2D with CV_32F output,
+///        measured on a VGA frame with Gabor kernels of growing size until filter2D wins
+int measure_quantized_kernel()
+{
+    const int largest_tried = 63;
+    cv::Mat image(480, 640, CV_8UC1);
+    cv::randu(image, cv::Scalar(0), cv::Scalar(256));
+    cv::Mat response;
 
-    return negative ? -truncated : truncated;
+    int largest = 1;
+    for (int size = 3; size <= largest_tried; size += 2)
+    {
+        const cv::Mat kernel = cv::getGaborKernel(cv::Size(size, size), size / 3.0, 0.7, size, 0.5);
+        const quantized_kernel q = quantize_kernel(kernel);
+        const int64 direct = best_ticks([&] { correlate_quantized(image, q, response, cv::BORDER_REFLECT_101); });
+        const int64 reference = best_ticks([&] { cv::filter2D(image, response, CV_32F, kernel); });
+        if (direct >= reference)
+            break;
+        largest = size;
+    }
+    return largest;
 }
 
+/// \brief Set of Gabor filters which forms texture descriptor
+struct gabor_bank
+{
+    std::vector<cv::Mat> kernels;
+    std::vector<quantized_kernel> quantized; // empty when float filtering is used
+};
 
-void calculateDescriptor(const cv::Mat& image, int kernel_size, descriptor& descr)
+gabor_bank make_gabor_bank(int kernel_size, bool quantized)
 {
-    descr.clear();
+    quantized = quantized && kernel_size <= cvlib::max_quantized_kernel();
+    gabor_bank bank;
     const std::vector<double> lm = {17, 29, 41, 59, 71, 89, 97};
-    cv::Mat response;
-    cv::Mat mean;
-    cv::Mat dev;
 
     // \todo implement complete texture segmentation based on Gabor filters
     // (find good combinations for all Gabor's parameters)
@@ -89,48 +205,175 @@ void calculateDescriptor(const cv::Mat& image, int kernel_size, descriptor& desc
         {
             for (auto l : lm) {
                 for (auto gm = 0.25; gm <= 1; ++gm) {
-                    cv::Mat kernel = cv::getGaborKernel(cv::Size(kernel_size, kernel_size), sig, th, l, gm);
-                    cv::filter2D(image, response, CV_32F, kernel);
-                    cv::meanStdDev(response, mean, dev);
-                    descr.emplace_back(mean.at<double>(0));
-                    descr.emplace_back(dev.at<double>(0));
+                    bank.kernels.emplace_back(cv::getGaborKernel(cv::Size(kernel_size, kernel_size), sig, th, l, gm));
+                    if (quantized)
+                        bank.quantized.emplace_back(quantize_kernel(bank.kernels.back()));
                 }
             }
         }
     }
+    return bank;
 }
-} // namespace
 
-namespace cvlib
+/// \brief Response of i-th filter of the bank for the whole image
+void filter_response(const cv::Mat& image, const gabor_bank& bank, size_t i, int border, cv::Mat& response)
 {
-cv::Mat select_texture(const cv::Mat& image, const cv::Rect& roi, double eps)
+    if (bank.quantized.empty())
+        cv::filter2D(image, response, CV_32F, bank.kernels[i], cv::Point(-1, -1), 0, border);
+    else
+        correlate_quantized(image, bank.quantized[i], response, border);
+}
+
+/// \brief Mean and deviation of the response over the window centered at every pixel
+void local_statistics(const cv::Mat& response, cv::Size window, int border, cv::Mat& mean, cv::Mat& dev)
 {
-    cv::Mat imROI = image(roi);
+    cv::boxFilter(response, mean, CV_32F, window, cv::Point(-1, -1), true, border);
+    cv::sqrBoxFilter(response, dev, CV_32F, window, cv::Point(-1, -1), true, border);
+    for (int y = 0; y < mean.rows; ++y)
+    {
+        const float* m = mean.ptr<float>(y);
+        float* d = dev.ptr<float>(y);
+        for (int x = 0; x < mean.cols; ++x)
+        {
+            d[x] = std::sqrt(std::max(d[x] - m[x] * m[x], 0.0f));
+        }
+    }
+}
 
-    const int kernel_size = round_to_odd(std::min(roi.height, roi.width) / 2); // \todo round to nearest odd
+/// \brief Gabor filters are applied to intensity, so colour images are converted to grayscale
+cv::Mat to_gray(const cv::Mat& image)
+{
+    if (image.channels() == 1)
+        return image;
 
-    descriptor reference;
-    calculateDescriptor(image(roi), kernel_size, reference);
+    CV_Assert(image.channels() == 3 || image.channels() == 4);
+    cv::Mat gray;
+    cv::cvtColor(image, gray, image.channels() == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+    return gray;
+}
 
-    cv::Mat res = cv::Mat::zeros(image.size(), CV_8UC1);
+/// \brief Responses of all filters of the bank at nodes of the grid with given step over the area, one sample per row
+void sample_responses(const cv::Mat& image, const cv::Rect& area, int step, const gabor_bank& bank, int border, cv::Mat& samples)
+{
+    // border is built from pixels around the view of the area, the same as when the whole image is filtered
+    const int r = bank.kernels.front().rows / 2;
+    cv::Mat padded;
+    cv::copyMakeBorder(image(area), padded, r, r, r, r, border);
+    padded.convertTo(padded, CV_64F);
 
-    descriptor test(reference.size());
-    cv::Rect baseROI = roi - roi.tl();
+    cv::Mat sample(1, static_cast<int>(bank.kernels.size()), CV_64F);
+    for (int y = 0; y < area.height; y += step)
+    {
+        for (int x = 0; x < area.width; x += step)
+        {
+            const cv::Mat patch = padded(cv::Rect(x, y, 2 * r + 1, 2 * r + 1));
+            for (size_t i = 0; i < bank.kernels.size(); ++i)
+            {
+                sample.at<double>(static_cast<int>(i)) = patch.dot(bank.kernels[i]);
+            }
+            samples.push_back(sample);
+        }
+    }
+}
+
+/// \brief Learns eigen-filters: principal components of the bank responses as combinations of its kernels,
+///        the response of such a filter is projection of all the bank responses onto the component.
+///        Responses are sampled around the ROI or, when given, over training patches
+gabor_bank learn_eigen_filters(const cv::Mat& image, const cv::Rect& roi, const gabor_bank& bank, const cvlib::texture_params& params)
+{
+    // neighbouring responses of the same kernel are similar, so half of kernel size is dense enough
+    const int step = std::max(1, bank.kernels.front().rows / 2);
+    cv::Mat samples;
+    if (params.training.empty())
+    {
+        const cv::Rect around(roi.x - roi.width, roi.y - roi.height, 3 * roi.width, 3 * roi.height);
+        sample_responses(image, around & cv::Rect(cv::Point(0, 0), image.size()), step, bank, params.border, samples);
+    }
+    else
+    {
+        for (const auto& patch : params.training)
+        {
+            sample_responses(to_gray(patch), cv::Rect(cv::Point(0, 0), patch.size()), step, bank, params.border, samples);
+        }
+    }
+    CV_Assert(samples.rows > params.components);
 
-    // \todo move ROI smoothly pixel-by-pixel
-    // to move roi pixel-by-pixel, we should consider corner cases, where filter doesnt fit into the image
-    // e.g. point 0,0
-    // we can use padding or, as here, just don't consider such points
-    for (int i = roi.width; i < image.size().width - roi.width; ++i)
+    const cv::PCA pca(samples, cv::noArray(), cv::PCA::DATA_AS_ROW, params.components);
+    gabor_bank eigen;
+    for (int k = 0; k < pca.eigenvectors.rows; ++k)
     {
-        for (int j = roi.height; j < image.size().height - roi.height; ++j)
+        cv::Mat kernel = cv::Mat::zeros(bank.kernels.front().size(), CV_64F);
+        for (size_t i = 0; i < bank.kernels.size(); ++i)
         {
-            auto curROI = baseROI + cv::Point(i, j); // pixel by pixel roi
-            calculateDescriptor(image(curROI), kernel_size, test);
-            res(curROI) = 255 * ((test - reference).norm_l2() <= eps);
+            cv::scaleAdd(bank.kernels[i], pca.eigenvectors.at<double>(k, static_cast<int>(i)), kernel, kernel);
         }
+        eigen.kernels.push_back(kernel);
+        if (!bank.quantized.empty())
+            eigen.quantized.emplace_back(quantize_kernel(kernel));
+    }
+    return eigen;
+}
+
+/// \brief dist += (feature - reference)^2
+void accumulate_distance(const cv::Mat& feature, float reference, cv::Mat& dist)
+{
+    for (int y = 0; y < dist.rows; ++y)
+    {
+        const float* f = feature.ptr<float>(y);
+        float* d = dist.ptr<float>(y);
+        for (int x = 0; x < dist.cols; ++x)
+        {
+            d[x] += (f[x] - reference) * (f[x] - reference);
+        }
+    }
+}
+} // namespace
+
+namespace cvlib
+{
+int max_quantized_kernel()
+{
+    static const int largest = measure_quantized_kernel();
+    return largest;
+}
+
+void filter_quantized(const cv::Mat& image, const cv::Mat& kernel, cv::Mat& response, int border /*= cv::BORDER_REFLECT_101*/)
+{
+    CV_Assert(image.type() == CV_8UC1);
+    if (kernel.rows > max_quantized_kernel())
+        cv::filter2D(image, response, CV_32F, kernel, cv::Point(-1, -1), 0, border);
+    else
+        correlate_quantized(image, quantize_kernel(kernel), response, border);
+}
+
+cv::Mat select_texture(const cv::Mat& input, const cv::Rect& roi, double eps, const texture_params& params)
+{
+    const cv::Mat image = to_gray(input);
+    CV_Assert(!params.quantized || image.type() == CV_8UC1);
+    CV_Assert(params.border == cv::BORDER_REFLECT || params.border == cv::BORDER_REFLECT_101 || params.border == cv::BORDER_REPLICATE);
+
+    const int kernel_size = round_to_odd(std::min(roi.height, roi.width) / 2); // \todo round to nearest odd
+    gabor_bank bank = make_gabor_bank(kernel_size, params.quantized);
+    if (params.components > 0)
+        bank = learn_eigen_filters(image, roi, bank, params);
+
+    // every filter is applied once to the whole padded image, then descriptor of each pixel is formed by
+    // the statistics over ROI-sized window centered at it, and the reference is the descriptor of ROI center
+    const cv::Point center(roi.x + roi.width / 2, roi.y + roi.height / 2);
+
+    // squared distance is accumulated filter by filter, so only one response is kept at a time
+    cv::Mat dist = cv::Mat::zeros(image.size(), CV_32F);
+    cv::Mat response;
+    cv::Mat mean;
+    cv::Mat dev;
+    for (size_t i = 0; i < bank.kernels.size(); ++i)
+    {
+        filter_response(image, bank, i, params.border, response);
+        local_statistics(response, roi.size(), params.border, mean, dev);
+        accumulate_distance(mean, mean.at<float>(center), dist);
+        accumulate_distance(dev, dev.at<float>(center), dist);
     }
 
-    return res;
+    return dist <= eps;
 }
 } // namespace cvlib
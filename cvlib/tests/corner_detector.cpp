@@ -101,3 +101,153 @@ TEST_CASE("simple check", "[corner_detector_fast]")
         REQUIRE(out.empty());
     }
 }
+
+namespace
+{
+/// \brief Straightforward FAST-N
+std::vector<cv::Point> reference_corners(const cv::Mat& image, int threshold = 30, int arc = 12)
+{
+    const cv::Point circle[16] = {{0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3},
+                                  {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}};
+    std::vector<cv::Point> corners;
+    for (int y = 3; y < image.rows - 3; ++y)
+    {
+        for (int x = 3; x < image.cols - 3; ++x)
+        {
+            const int v = image.at<uint8_t>(y, x);
+            int bright = 0;
+            int dark = 0;
+            bool corner = false;
+            for (int k = 0; k < 32 && !corner; ++k)
+            {
+                const int c = image.at<uint8_t>(cv::Point(x, y) + circle[k % 16]);
+                bright = c > v + threshold ? bright + 1 : 0;
+                dark = c < v - threshold ? dark + 1 : 0;
+                corner = bright >= arc || dark >= arc;
+            }
+            if (corner)
+                corners.emplace_back(x, y);
+        }
+    }
+    return corners;
+}
+} // namespace
+
+TEST_CASE("random image", "[corner_detector_fast]")
+{
+    auto fast = corner_detector_fast::create();
+    fast->set_nonmax_suppression(false);
+    cv::Mat image(60, 83, CV_8UC1);
+    cv::randu(image, cv::Scalar(0), cv::Scalar(256));
+    cv::GaussianBlur(image, image, cv::Size(3, 3), 0);
+
+    std::vector<cv::KeyPoint> out;
+    fast->detect(image, out);
+    const auto expected = reference_corners(image);
+    REQUIRE(expected.size() == out.size());
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        REQUIRE(expected[i] == cv::Point(out[i].pt));
+    }
+}
+
+TEST_CASE("input layout", "[corner_detector_fast]")
+{
+    auto fast = corner_detector_fast::create();
+    fast->set_nonmax_suppression(false);
+    cv::Mat frame(70, 90, CV_8UC1);
+    cv::randu(frame, cv::Scalar(0), cv::Scalar(256));
+    cv::GaussianBlur(frame, frame, cv::Size(3, 3), 0);
+    const cv::Mat image = frame(cv::Rect(5, 4, 61, 50)); // row step differs from width
+
+    std::vector<cv::KeyPoint> out;
+    fast->detect(image, out);
+    const auto expected = reference_corners(image);
+    REQUIRE(expected.size() == out.size());
+
+    SECTION("color")
+    {
+        cv::Mat color;
+        cv::cvtColor(image, color, cv::COLOR_GRAY2BGR);
+        std::vector<cv::KeyPoint> color_out;
+        fast->detect(color, color_out);
+        REQUIRE(out.size() == color_out.size());
+    }
+}
+
+TEST_CASE("non-maximum suppression", "[corner_detector_fast]")
+{
+    auto fast = corner_detector_fast::create();
+
+    SECTION("score")
+    {
+        cv::Mat image(7, 7, CV_8UC1, cv::Scalar(15));
+        image.at<uint8_t>(3, 3) = 228;
+        std::vector<cv::KeyPoint> out;
+        fast->detect(image, out);
+        REQUIRE(1 == out.size());
+        REQUIRE(out[0].response == 212); // 15 < 228 - t holds up to t = 212
+    }
+
+    SECTION("random image")
+    {
+        cv::Mat image(60, 83, CV_8UC1);
+        cv::randu(image, cv::Scalar(0), cv::Scalar(256));
+        cv::GaussianBlur(image, image, cv::Size(3, 3), 0);
+
+        std::vector<cv::KeyPoint> out;
+        fast->detect(image, out);
+        const auto all = reference_corners(image);
+        REQUIRE(!out.empty());
+        REQUIRE(out.size() < all.size());
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            REQUIRE(std::find(all.begin(), all.end(), cv::Point(out[i].pt)) != all.end());
+            REQUIRE(out[i].response >= 30);
+            for (size_t j = i + 1; j < out.size(); ++j)
+            {
+                const cv::Point d = cv::Point(out[i].pt) - cv::Point(out[j].pt);
+                REQUIRE(std::max(std::abs(d.x), std::abs(d.y)) > 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("detector variants", "[corner_detector_fast]")
+{
+    cv::Mat image(60, 83, CV_8UC1);
+    cv::randu(image, cv::Scalar(0), cv::Scalar(256));
+    cv::GaussianBlur(image, image, cv::Size(3, 3), 0);
+
+    for (auto type : {corner_detector_fast::detector_type::fast_9, corner_detector_fast::detector_type::fast_10,
+                      corner_detector_fast::detector_type::fast_12})
+    {
+        for (int threshold : {10, 30, 60})
+        {
+            auto fast = corner_detector_fast::create(threshold, type);
+            fast->set_nonmax_suppression(false);
+            std::vector<cv::KeyPoint> out;
+            fast->detect(image, out);
+            const auto expected = reference_corners(image, threshold, static_cast<int>(type));
+            REQUIRE(expected.size() == out.size());
+            for (size_t i = 0; i < out.size(); ++i)
+            {
+                REQUIRE(expected[i] == cv::Point(out[i].pt));
+            }
+        }
+    }
+
+    SECTION("threshold")
+    {
+        auto fast = corner_detector_fast::create(30, corner_detector_fast::detector_type::fast_9);
+        cv::Mat corner(7, 7, CV_8UC1, cv::Scalar(100));
+        corner.at<uint8_t>(3, 3) = 140;
+        std::vector<cv::KeyPoint> out;
+        fast->detect(corner, out);
+        REQUIRE(1 == out.size());
+
+        fast->set_threshold(40);
+        fast->detect(corner, out);
+        REQUIRE(out.empty());
+    }
+}
@@ -0,0 +1,495 @@
+/* Motion segmentation algorithm testing.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+#include "cvlib.hpp"
+
+using namespace cvlib;
+
+TEST_CASE("buffer mean", "[motion_segmentation]")
+{
+    Buffer buffer(2);
+    cv::Mat frame(4, 6, CV_8UC3, cv::Scalar(10, 20, 30));
+    buffer.push_back(frame);
+    REQUIRE(cv::Scalar(10, 20, 30) == cv::mean(buffer.get_mean()));
+
+    SECTION("reused frame")
+    {
+        frame.setTo(cv::Scalar(30, 40, 50));
+        buffer.push_back(frame);
+        REQUIRE(cv::Scalar(20, 30, 40) == cv::mean(buffer.get_mean()));
+
+        frame.setTo(cv::Scalar(50, 60, 70));
+        buffer.push_back(frame);
+        REQUIRE(cv::Scalar(40, 50, 60) == cv::mean(buffer.get_mean()));
+        REQUIRE(2 == buffer.size());
+        REQUIRE(cv::Scalar(30, 40, 50) == cv::mean(buffer[0]));
+        REQUIRE(cv::Scalar(50, 60, 70) == cv::mean(buffer[1]));
+    }
+
+    SECTION("frame size change")
+    {
+        buffer.push_back(cv::Mat(8, 8, CV_8UC3, cv::Scalar(1, 2, 3)));
+        REQUIRE(1 == buffer.size());
+        REQUIRE(cv::Scalar(1, 2, 3) == cv::mean(buffer.get_mean()));
+    }
+
+    SECTION("long window")
+    {
+        Buffer long_buffer(300);
+        for (int i = 0; i < 600; ++i)
+        {
+            long_buffer.push_back(cv::Mat(4, 6, CV_8UC1, cv::Scalar(i % 2 ? 100 : 50)));
+        }
+        REQUIRE(cv::Scalar(75) == cv::mean(long_buffer.get_mean()));
+    }
+}
+
+namespace
+{
+const motion_segmentation::model_type all_models[] = {motion_segmentation::model_type::running_average, motion_segmentation::model_type::min_max,
+                                                      motion_segmentation::model_type::mean, motion_segmentation::model_type::gaussian,
+                                                      motion_segmentation::model_type::gmm, motion_segmentation::model_type::running_average_fixed,
+                                                      motion_segmentation::model_type::vibe, motion_segmentation::model_type::codebook};
+} // namespace
+
+TEST_CASE("background models", "[motion_segmentation]")
+{
+    const cv::Mat background(20, 30, CV_8UC3, cv::Scalar(50, 100, 150));
+    cv::Mat mask;
+
+    SECTION("static scene")
+    {
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(background, type);
+            mseg.apply(background, mask, 0.1);
+            REQUIRE(background.size() == mask.size());
+            REQUIRE(CV_8UC1 == mask.type());
+            REQUIRE(0 == cv::countNonZero(mask));
+        }
+    }
+
+    SECTION("moving object")
+    {
+        cv::Mat frame = background.clone();
+        frame(cv::Rect(5, 5, 4, 4)).setTo(cv::Scalar(250, 250, 250));
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(background, type);
+            mseg.apply(frame, mask, 0.1);
+            REQUIRE(16 == cv::countNonZero(mask));
+            REQUIRE(255 == mask.at<uchar>(6, 6));
+        }
+    }
+
+    SECTION("background image")
+    {
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(background, type);
+            cv::Mat bg;
+            mseg.getBackgroundImage(bg);
+            REQUIRE(background.type() == bg.type());
+            REQUIRE(0 == cv::norm(background, bg, cv::NORM_INF));
+        }
+    }
+
+    SECTION("grayscale")
+    {
+        const cv::Mat gray(20, 30, CV_8UC1, cv::Scalar(80));
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(gray, type);
+            mseg.apply(gray, mask, 0.1);
+            REQUIRE(0 == cv::countNonZero(mask));
+        }
+    }
+}
+
+TEST_CASE("sample diffusion", "[motion_segmentation]")
+{
+    // ghost of an object present at initialization spans all columns, so only vertical neighbours absorb it
+    const cv::Mat frame(20, 30, CV_8UC1, cv::Scalar(50));
+    cv::Mat background = frame.clone();
+    background.rowRange(8, 12).setTo(250);
+    motion_segmentation mseg(background, motion_segmentation::model_type::vibe);
+
+    cv::Mat mask;
+    mseg.apply(frame, mask, 1);
+    REQUIRE(4 * 30 == cv::countNonZero(mask));
+    for (int i = 0; i < 100; ++i)
+        mseg.apply(frame, mask, 1);
+    REQUIRE(0 == cv::countNonZero(mask));
+}
+
+TEST_CASE("sub-LSB learning", "[motion_segmentation]")
+{
+    const cv::Mat background(4, 20, CV_8UC1, cv::Scalar(100));
+    const cv::Mat frame(4, 20, CV_8UC1, cv::Scalar(104));
+    cv::Mat mask;
+    cv::Mat bg;
+
+    motion_segmentation fixed(background, motion_segmentation::model_type::running_average_fixed);
+    motion_segmentation blend(background, motion_segmentation::model_type::running_average);
+    for (int i = 0; i < 200; ++i)
+    {
+        fixed.apply(frame, mask, 0.01);
+        blend.apply(frame, mask, 0.01);
+    }
+
+    fixed.getBackgroundImage(bg);
+    REQUIRE(cv::Scalar(103) == cv::mean(bg));
+    blend.getBackgroundImage(bg);
+    REQUIRE(cv::Scalar(100) == cv::mean(bg));
+}
+
+TEST_CASE("tiled processing", "[motion_segmentation]")
+{
+    cv::Mat background(64, 40, CV_8UC3);
+    cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Mat frame(64, 40, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    for (const auto type : all_models)
+    {
+        motion_segmentation single(background, type);
+        single.set_min_tile_rows(background.rows);
+        motion_segmentation tiled(background, type);
+        tiled.set_min_tile_rows(1);
+
+        cv::Mat single_mask;
+        cv::Mat tiled_mask;
+        single.apply(frame, single_mask, 0.1);
+        tiled.apply(frame, tiled_mask, 0.1);
+        REQUIRE(0 == cv::norm(single_mask, tiled_mask, cv::NORM_INF));
+
+        cv::Mat single_bg;
+        cv::Mat tiled_bg;
+        single.getBackgroundImage(single_bg);
+        tiled.getBackgroundImage(tiled_bg);
+        REQUIRE(0 == cv::norm(single_bg, tiled_bg, cv::NORM_INF));
+    }
+}
+
+TEST_CASE("block gating", "[motion_segmentation]")
+{
+    cv::Mat background(48, 64, CV_8UC3);
+    cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Mat mask;
+
+    SECTION("quiet scene")
+    {
+        cv::Mat frame;
+        cv::add(background, cv::Scalar::all(2), frame);
+        frame(cv::Rect(20, 20, 4, 4)).setTo(cv::Scalar(255, 255, 255));
+        background(cv::Rect(20, 20, 4, 4)).setTo(cv::Scalar(0, 0, 0));
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(background, type);
+            mseg.set_block_gating(16, 4);
+            mseg.apply(frame, mask, 0.1);
+            REQUIRE(16 == cv::countNonZero(mask));
+            REQUIRE(255 == mask.at<uchar>(21, 21));
+        }
+    }
+
+    SECTION("zero noise floor")
+    {
+        cv::Mat frame(48, 64, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        for (const auto type : all_models)
+        {
+            motion_segmentation plain(background, type);
+            motion_segmentation gated(background, type);
+            gated.set_block_gating(16, 0);
+
+            cv::Mat plain_mask;
+            cv::Mat gated_mask;
+            plain.apply(frame, plain_mask, 0.1);
+            gated.apply(frame, gated_mask, 0.1);
+            REQUIRE(0 == cv::norm(plain_mask, gated_mask, cv::NORM_INF));
+        }
+    }
+}
+
+TEST_CASE("blob output", "[motion_segmentation]")
+{
+    const cv::Mat background(40, 60, CV_8UC1, cv::Scalar(50));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(5, 5, 4, 4)).setTo(250);
+    frame(cv::Rect(30, 10, 10, 2)).setTo(250);
+    frame(cv::Rect(40, 12, 3, 3)).setTo(250); // touches the previous one diagonally
+
+    for (const int block_size : {0, 16})
+    {
+        motion_segmentation mseg(background);
+        mseg.set_block_gating(block_size, 1);
+        cv::Mat mask;
+        mseg.apply(frame, mask, 0.1);
+        REQUIRE(mseg.blobs().empty());
+
+        mseg.set_blob_output(true);
+        mseg.apply(frame, mask, 0);
+        const auto& blobs = mseg.blobs();
+        REQUIRE(2 == blobs.size());
+        REQUIRE(cv::Rect(5, 5, 4, 4) == blobs[0].bbox);
+        REQUIRE(16 == blobs[0].area);
+        REQUIRE(cv::Point2d(6.5, 6.5) == blobs[0].centroid);
+        REQUIRE(cv::Rect(30, 10, 13, 5) == blobs[1].bbox);
+        REQUIRE(29 == blobs[1].area);
+    }
+}
+
+TEST_CASE("model snapshot", "[motion_segmentation]")
+{
+    cv::Mat background(24, 40, CV_8UC3);
+    cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Mat frame(24, 40, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    const std::string path = "motion_segmentation_snapshot.bin";
+
+    for (const auto type : all_models)
+    {
+        motion_segmentation original(background, type);
+        original.set_threshold(30);
+        cv::Mat mask;
+        original.apply(frame, mask, 0.2);
+        original.save(path);
+
+        motion_segmentation restored(frame);
+        restored.load(path);
+        REQUIRE(type == restored.type());
+
+        cv::Mat original_bg;
+        cv::Mat restored_bg;
+        original.getBackgroundImage(original_bg);
+        restored.getBackgroundImage(restored_bg);
+        REQUIRE(0 == cv::norm(original_bg, restored_bg, cv::NORM_INF));
+
+        cv::Mat original_mask;
+        cv::Mat restored_mask;
+        original.apply(background, original_mask, 0.2);
+        restored.apply(background, restored_mask, 0.2);
+        REQUIRE(0 == cv::norm(original_mask, restored_mask, cv::NORM_INF));
+    }
+
+    SECTION("broken file")
+    {
+        std::ofstream(path) << "not a snapshot";
+        motion_segmentation mseg(background);
+        REQUIRE_THROWS_AS(mseg.load(path), cv::Exception);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("processing scale", "[motion_segmentation]")
+{
+    const cv::Mat background(64, 64, CV_8UC1, cv::Scalar(50));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(18, 18, 12, 12)).setTo(250);
+    cv::Mat mask;
+    cv::Mat bg;
+
+    motion_segmentation mseg(background);
+    mseg.set_processing_scale(4);
+    mseg.getBackgroundImage(bg);
+    REQUIRE(cv::Size(16, 16) == bg.size());
+
+    SECTION("upsampled mask")
+    {
+        mseg.apply(frame, mask, 0);
+        REQUIRE(background.size() == mask.size());
+        REQUIRE(16 * 16 == cv::countNonZero(mask));
+        REQUIRE(255 == mask.at<uchar>(16, 16));
+    }
+
+    SECTION("refined edges")
+    {
+        mseg.set_processing_scale(4, true);
+        mseg.apply(frame, mask, 0);
+        REQUIRE(12 * 12 == cv::countNonZero(mask));
+        REQUIRE(0 == mask.at<uchar>(17, 17));
+        REQUIRE(255 == mask.at<uchar>(18, 18));
+    }
+}
+
+TEST_CASE("processing scale of odd frame size", "[motion_segmentation]")
+{
+    // 70 x 66 frame is not divisible by the scale, so cells are mapped to pixels as by the upsampling
+    const cv::Mat background(66, 70, CV_8UC1, cv::Scalar(50));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(40, 20, 13, 12)).setTo(250);
+    cv::Mat mask;
+
+    motion_segmentation mseg(background);
+    mseg.set_processing_scale(4, true);
+    mseg.set_blob_output(true);
+
+    SECTION("refined edges")
+    {
+        mseg.apply(frame, mask, 0);
+        REQUIRE(13 * 12 == cv::countNonZero(mask));
+        REQUIRE(0 == mask.at<uchar>(19, 39));
+        REQUIRE(255 == mask.at<uchar>(31, 52));
+        REQUIRE(1 == mseg.blobs().size());
+        REQUIRE(cv::Rect(40, 20, 13, 12) == mseg.blobs()[0].bbox);
+    }
+
+    SECTION("blobs within roi")
+    {
+        cv::Mat roi = cv::Mat::zeros(background.size(), CV_8UC1);
+        roi(cv::Rect(0, 0, 46, 66)).setTo(1);
+        mseg.set_roi(roi);
+        mseg.apply(frame, mask, 0);
+        REQUIRE(1 == mseg.blobs().size());
+        const auto& b = mseg.blobs()[0];
+        REQUIRE(cv::countNonZero(mask) == b.area);
+        REQUIRE(cv::boundingRect(mask) == b.bbox);
+        REQUIRE(b.bbox.x + b.bbox.width <= 46);
+    }
+}
+
+TEST_CASE("adaptive learning rate", "[motion_segmentation]")
+{
+    const cv::Mat background(4, 40, CV_8UC3, cv::Scalar(100, 100, 100));
+    const cv::Mat frame(4, 40, CV_8UC3, cv::Scalar(116, 116, 116));
+    cv::Mat mask;
+    cv::Mat bg;
+
+    motion_segmentation adaptive(background);
+    adaptive.set_adaptive_rate(true);
+    motion_segmentation global(background);
+    for (int i = 0; i < 60; ++i)
+    {
+        adaptive.apply(background, mask, 0.1);
+        global.apply(background, mask, 0.1);
+    }
+
+    // a pixel stable for long learns faster
+    adaptive.apply(frame, mask, 0.1);
+    global.apply(frame, mask, 0.1);
+    adaptive.getBackgroundImage(bg);
+    REQUIRE(cv::Scalar(103, 103, 103) == cv::mean(bg));
+    global.getBackgroundImage(bg);
+    REQUIRE(cv::Scalar(102, 102, 102) == cv::mean(bg));
+
+    REQUIRE_THROWS_AS(motion_segmentation(background, motion_segmentation::model_type::gmm).set_adaptive_rate(true), cv::Exception);
+}
+
+TEST_CASE("compact mask formats", "[motion_segmentation]")
+{
+    const cv::Mat background(20, 37, CV_8UC1, cv::Scalar(50));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(5, 5, 4, 4)).setTo(250);
+    frame(cv::Rect(20, 8, 17, 3)).setTo(250);
+
+    cv::Mat expected;
+    for (const int scale : {1, 2})
+    {
+        motion_segmentation mseg(background);
+        mseg.set_processing_scale(scale);
+        mseg.apply(frame, expected, 0);
+
+        cv::Mat packed;
+        cv::Mat mask;
+        mseg.set_mask_format(motion_segmentation::mask_format::bits);
+        mseg.apply(frame, packed, 0);
+        REQUIRE(cv::Size(5, 20) == packed.size());
+        REQUIRE(cv::countNonZero(expected) == packed_count(packed));
+        unpack_mask(packed, frame.cols, mask);
+        REQUIRE(0 == cv::norm(expected, mask, cv::NORM_INF));
+
+        cv::Mat rle;
+        mseg.set_mask_format(motion_segmentation::mask_format::rle);
+        mseg.apply(frame, rle, 0);
+        REQUIRE(CV_32SC1 == rle.type());
+        decode_rle(rle, mask);
+        REQUIRE(0 == cv::norm(expected, mask, cv::NORM_INF));
+    }
+}
+
+TEST_CASE("packed mask helpers", "[motion_segmentation]")
+{
+    cv::Mat a = cv::Mat::zeros(3, 21, CV_8UC1);
+    cv::Mat b = cv::Mat::zeros(3, 21, CV_8UC1);
+    a(cv::Rect(0, 0, 12, 2)).setTo(255);
+    b(cv::Rect(8, 1, 13, 2)).setTo(255);
+
+    cv::Mat pa;
+    cv::Mat pb;
+    pack_mask(a, pa);
+    pack_mask(b, pb);
+    REQUIRE(24 == packed_count(pa));
+    REQUIRE(26 == packed_count(pb));
+
+    cv::Mat both;
+    packed_and(pa, pb, both);
+    REQUIRE(4 == packed_count(both));
+    packed_or(pa, pb, both);
+    REQUIRE(46 == packed_count(both));
+
+    cv::Mat rle;
+    cv::Mat decoded;
+    encode_rle(a, rle);
+    REQUIRE(2 + 3 + 2 * 2 == rle.cols);
+    decode_rle(rle, decoded);
+    REQUIRE(0 == cv::norm(a, decoded, cv::NORM_INF));
+
+    SECTION("nonzero values")
+    {
+        cv::Mat c = cv::Mat::zeros(2, 37, CV_8UC1);
+        c(cv::Rect(2, 0, 33, 1)).setTo(1);
+        c(cv::Rect(10, 1, 27, 1)).setTo(127);
+        cv::Mat pc;
+        pack_mask(c, pc);
+        REQUIRE(60 == packed_count(pc));
+        unpack_mask(pc, c.cols, decoded);
+        cv::Mat expected;
+        cv::compare(c, 0, expected, cv::CMP_NE);
+        REQUIRE(0 == cv::norm(expected, decoded, cv::NORM_INF));
+    }
+}
+
+TEST_CASE("region of interest", "[motion_segmentation]")
+{
+    const cv::Mat background(32, 48, CV_8UC3, cv::Scalar(50, 100, 150));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(4, 4, 4, 4)).setTo(cv::Scalar(250, 250, 250));
+    frame(cv::Rect(30, 20, 4, 4)).setTo(cv::Scalar(250, 250, 250));
+    // the last ROI column changes within threshold, so ViBe would spread it to its neighbours outside ROI
+    frame.col(20).setTo(cv::Scalar(70, 120, 170));
+
+    cv::Mat roi = cv::Mat::zeros(background.size(), CV_8UC1);
+    roi(cv::Rect(0, 0, 21, 32)).setTo(1);
+
+    for (const int block_size : {0, 16})
+    {
+        for (const auto type : all_models)
+        {
+            motion_segmentation mseg(background, type);
+            mseg.set_block_gating(block_size, 1);
+            mseg.set_roi(roi);
+            cv::Mat mask;
+            mseg.apply(frame, mask, 0.5);
+            REQUIRE(16 == cv::countNonZero(mask));
+            REQUIRE(255 == mask.at<uchar>(5, 5));
+            for (int i = 0; i < 10; ++i)
+                mseg.apply(frame, mask, 0.5);
+
+            // model outside ROI is untouched
+            cv::Mat bg;
+            mseg.getBackgroundImage(bg);
+            REQUIRE(0 == cv::norm(background(cv::Rect(30, 20, 4, 4)), bg(cv::Rect(30, 20, 4, 4)), cv::NORM_INF));
+            REQUIRE(0 == cv::norm(background.col(21), bg.col(21), cv::NORM_INF));
+        }
+    }
+}
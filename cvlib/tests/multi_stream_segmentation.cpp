@@ -0,0 +1,40 @@
+/* Multi-stream background subtraction testing.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include <catch2/catch.hpp>
+
+#include "cvlib.hpp"
+
+using namespace cvlib;
+
+TEST_CASE("multi-stream batches", "[multi_stream_segmentation]")
+{
+    const cv::Mat background(20, 30, CV_8UC1, cv::Scalar(50));
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(5, 5, 4, 4)).setTo(250);
+
+    multi_stream_segmentation service;
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(i == service.add_stream(background));
+    REQUIRE(3 == service.streams());
+    REQUIRE(0 == service.process_batch());
+
+    service.submit(0, background);
+    service.submit(0, frame);
+    service.submit(2, frame);
+    REQUIRE(2 == service.process_batch(0.1));
+
+    REQUIRE(16 == cv::countNonZero(service.mask(0)));
+    REQUIRE(service.mask(1).empty());
+    REQUIRE(16 == cv::countNonZero(service.mask(2)));
+
+    const auto stats = service.stats(0);
+    REQUIRE(1 == stats.processed);
+    REQUIRE(1 == stats.dropped);
+    REQUIRE(stats.last_latency_ms >= 0);
+    REQUIRE(0 == service.stats(1).processed);
+    REQUIRE(0 == service.stats(2).dropped);
+}
@@ -0,0 +1,75 @@
+/* Latency budget scheduler testing.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include <catch2/catch.hpp>
+
+#include "cvlib.hpp"
+
+using namespace cvlib;
+
+TEST_CASE("latency budget", "[segmentation_scheduler]")
+{
+    const cv::Mat background(8, 32, CV_8UC1, cv::Scalar(100));
+    const cv::Mat frame(8, 32, CV_8UC1, cv::Scalar(200));
+    motion_segmentation mseg(background);
+    segmentation_scheduler scheduler(mseg, 1000);
+    cv::Mat mask;
+
+    SECTION("fresh frames")
+    {
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(scheduler.process(background, mask));
+        REQUIRE(3 == scheduler.processed());
+        REQUIRE(0 == scheduler.skipped());
+        REQUIRE(scheduler.processing_ms() >= 0);
+    }
+
+    SECTION("late frames")
+    {
+        // frames captured 10 s ago are over the budget
+        const int64 late = cv::getTickCount() - static_cast<int64>(10 * cv::getTickFrequency());
+        scheduler.set_max_skipped(3);
+        for (int i = 0; i < 3; ++i)
+            REQUIRE_FALSE(scheduler.process(frame, mask, 0.1, late));
+        REQUIRE(mask.empty());
+        REQUIRE(scheduler.process(frame, mask, 0.1, late));
+        REQUIRE(1 == scheduler.processed());
+        REQUIRE(3 == scheduler.skipped());
+
+        // learning rate of four frames: 1 - 0.9^4
+        cv::Mat bg;
+        mseg.getBackgroundImage(bg);
+        REQUIRE(cv::Scalar(134) == cv::mean(bg));
+    }
+}
+
+TEST_CASE("rate of non-blending models", "[segmentation_scheduler]")
+{
+    const cv::Mat background(8, 32, CV_8UC1, cv::Scalar(100));
+    const cv::Mat frame(8, 32, CV_8UC1, cv::Scalar(200));
+    const int64 late = cv::getTickCount() - static_cast<int64>(10 * cv::getTickFrequency());
+    cv::Mat mask;
+
+    for (const auto type : {motion_segmentation::model_type::mean, motion_segmentation::model_type::codebook})
+    {
+        // the processed frame after skipped ones learns as a single frame
+        motion_segmentation scheduled(background, type);
+        segmentation_scheduler scheduler(scheduled, 1000);
+        scheduler.set_max_skipped(3);
+        for (int i = 0; i < 4; ++i)
+            scheduler.process(frame, mask, 0.1, late);
+        REQUIRE(1 == scheduler.processed());
+
+        motion_segmentation direct(background, type);
+        direct.apply(frame, mask, 0.1);
+
+        cv::Mat scheduled_bg;
+        cv::Mat direct_bg;
+        scheduled.getBackgroundImage(scheduled_bg);
+        direct.getBackgroundImage(direct_bg);
+        REQUIRE(0 == cv::norm(scheduled_bg, direct_bg, cv::NORM_INF));
+    }
+}
@@ -0,0 +1,151 @@
+/* Texture segmentation algorithm testing.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include <catch2/catch.hpp>
+
+#include <climits>
+
+#include "cvlib.hpp"
+
+using namespace cvlib;
+
+TEST_CASE("constant texture", "[select_texture]")
+{
+    const cv::Mat image(48, 64, CV_8UC1, cv::Scalar(100));
+    const cv::Rect roi(28, 20, 8, 8);
+    texture_params params;
+
+    SECTION("float")
+    {
+    }
+
+    SECTION("quantized")
+    {
+        params.quantized = true;
+    }
+
+    SECTION("replicate border")
+    {
+        params.border = cv::BORDER_REPLICATE;
+    }
+
+    SECTION("pca")
+    {
+        params.components = 4;
+    }
+
+    const auto res = select_texture(image, roi, 1, params);
+    REQUIRE(image.size() == res.size());
+    REQUIRE(CV_8UC1 == res.type());
+    REQUIRE(static_cast<int>(image.total()) == cv::countNonZero(res));
+}
+
+TEST_CASE("two textures", "[select_texture]")
+{
+    // Gabor kernels are odd, so the second texture is stripes rather than a constant
+    cv::Mat image(64, 64, CV_8UC1, cv::Scalar(0));
+    for (int x = 32; x < 64; x += 4)
+    {
+        image.colRange(x, x + 2).setTo(255);
+    }
+    // responses around the ROI cover both textures
+    const cv::Rect roi(20, 28, 8, 8);
+
+    texture_params params;
+    SECTION("float")
+    {
+    }
+
+    SECTION("quantized")
+    {
+        params.quantized = true;
+    }
+
+    SECTION("pca")
+    {
+        params.components = 2;
+    }
+
+    SECTION("pca from training patches")
+    {
+        params.components = 2;
+        params.training = {image(cv::Rect(0, 0, 16, 16)), image(cv::Rect(48, 0, 16, 16)), image(cv::Rect(24, 24, 16, 16))};
+    }
+
+    const auto res = select_texture(image, roi, 1, params);
+    REQUIRE(255 == res.at<uchar>(0, 0));
+    REQUIRE(255 == res.at<uchar>(63, 0));
+    REQUIRE(0 == res.at<uchar>(0, 63));
+    REQUIRE(0 == res.at<uchar>(63, 63));
+}
+
+TEST_CASE("colour input", "[select_texture]")
+{
+    cv::Mat image(64, 64, CV_8UC3, cv::Scalar(30, 60, 90));
+    for (int x = 32; x < 64; x += 4)
+    {
+        image.colRange(x, x + 2).setTo(cv::Scalar(200, 150, 100));
+    }
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    const cv::Rect roi(20, 28, 8, 8);
+
+    texture_params params;
+    SECTION("float")
+    {
+    }
+
+    SECTION("quantized")
+    {
+        params.quantized = true;
+    }
+
+    SECTION("pca from training patches")
+    {
+        params.components = 2;
+        params.training = {image(cv::Rect(0, 0, 16, 16)), image(cv::Rect(48, 0, 16, 16))};
+    }
+
+    const auto res = select_texture(image, roi, 1, params);
+    REQUIRE(image.size() == res.size());
+    REQUIRE(0 == cv::norm(select_texture(gray, roi, 1, params), res, cv::NORM_INF));
+}
+
+TEST_CASE("too few samples for pca", "[select_texture]")
+{
+    const cv::Mat image(16, 16, CV_8UC1, cv::Scalar(100));
+    texture_params params;
+    params.components = 8;
+    params.training = {image(cv::Rect(0, 0, 4, 4))};
+    REQUIRE_THROWS_AS(select_texture(image, cv::Rect(4, 4, 8, 8), 1, params), cv::Exception);
+}
+
+TEST_CASE("quantized filtering", "[select_texture]")
+{
+    cv::Mat image(40, 50, CV_8UC1);
+    cv::randu(image, cv::Scalar(0), cv::Scalar(256));
+
+    const int largest = max_quantized_kernel();
+    REQUIRE(largest >= 1);
+    for (int size = 3; size <= largest + 2; size += 2)
+    {
+        const cv::Mat kernel = cv::getGaborKernel(cv::Size(size, size), size / 3.0, 0.7, size, 0.5);
+        cv::Mat expected;
+        cv::Mat response;
+        cv::filter2D(image, expected, CV_32F, kernel);
+        filter_quantized(image, kernel, response);
+        REQUIRE(CV_32F == response.type());
+        REQUIRE(image.size() == response.size());
+
+        // the largest scale keeping weights in int16 and the accumulator in int32, see filter_quantized
+        const double taps = static_cast<double>(size) * size;
+        const double scale = std::min(SHRT_MAX / cv::norm(kernel, cv::NORM_INF), (INT_MAX / 255.0 - 0.5 * taps) / cv::norm(kernel, cv::NORM_L1));
+        const double bound = 127.5 * taps / scale;
+        REQUIRE(cv::norm(expected, response, cv::NORM_INF) <= bound + 1e-3);
+        if (size > largest)
+            REQUIRE(0 == cv::norm(expected, response, cv::NORM_INF));
+    }
+}
@@ -7,6 +7,7 @@
 #include <cvlib.hpp>
 #include <opencv2/opencv.hpp>
 
+#include "pipeline.hpp"
 #include "utils.hpp"
 
 int demo_corner_detector(int argc, char* argv[])
@@ -21,28 +22,31 @@ int demo_corner_detector(int argc, char* argv[])
     cv::namedWindow(main_wnd);
     cv::namedWindow(demo_wnd);
 
-    cv::Mat frame;
     auto detector = cvlib::corner_detector_fast::create();
     std::vector<cv::KeyPoint> corners;
 
     utils::fps_counter fps;
-    while (cv::waitKey(30) != 27) // ESC
-    {
-        cap >> frame;
-        cv::imshow(main_wnd, frame);
-
-        detector->detect(frame, corners);
-        cv::drawKeypoints(frame, corners, frame, cv::Scalar(0, 0, 255));
-        utils::put_fps_text(frame, fps);
-        // \todo add count of the detected corners at the top left corner of the image. Use green text color.
-        cv::putText(frame, 
-            "number of corners: " + std::to_string(corners.size()), 
-            cv::Point(25, 25), // top-left position
-            cv::FONT_HERSHEY_SIMPLEX, 
-            1.0, 
-            CV_RGB(0, 255, 0));
-        cv::imshow(demo_wnd, frame);
-    }
+    utils::pipeline pipe([&cap](cv::Mat& frame) { return cap.read(frame); },
+                         [&](const cv::Mat& frame) {
+                             cv::Mat demo;
+                             detector->detect(frame, corners);
+                             cv::drawKeypoints(frame, corners, demo, cv::Scalar(0, 0, 255));
+                             // \todo add count of the detected corners at the top left corner of the image. Use green text color.
+                             cv::putText(demo,
+                                 "number of corners: " + std::to_string(corners.size()),
+                                 cv::Point(25, 25), // top-left position
+                                 cv::FONT_HERSHEY_SIMPLEX,
+                                 1.0,
+                                 CV_RGB(0, 255, 0));
+                             return demo;
+                         });
+
+    pipe.run([&](utils::processed_frame& item) {
+        cv::imshow(main_wnd, item.frame);
+        utils::put_fps_text(item.result, fps);
+        cv::imshow(demo_wnd, item.result);
+        return cv::waitKey(1) != 27; // ESC
+    });
 
     cv::destroyWindow(main_wnd);
     cv::destroyWindow(demo_wnd);
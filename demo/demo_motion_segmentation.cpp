@@ -7,6 +7,11 @@
 #include <cvlib.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <atomic>
+#include <utility>
+
+#include "pipeline.hpp"
+
 int demo_motion_segmentation(int argc, char* argv[])
 {
     cv::VideoCapture cap(0);
@@ -23,6 +28,7 @@ int demo_motion_segmentation(int argc, char* argv[])
     }
 
     auto mseg = cvlib::motion_segmentation(buffer.get_mean());
+    mseg.set_adaptive_rate(true);
     const auto main_wnd = "orig";
     const auto demo_wnd = "demo";
 
@@ -30,23 +36,64 @@ int demo_motion_segmentation(int argc, char* argv[])
     cv::namedWindow(main_wnd);
     cv::namedWindow(demo_wnd);
     int rate_track = (int)(255.0 / buff_size);
-    double learning_rate = rate_track / 255.0;
     cv::createTrackbar("rate", demo_wnd, &rate_track, 255);
-    
+    int model = 0;
 
-    cv::Mat frame;
-    cv::Mat frame_mseg;
-    while (cv::waitKey(30) != 27) // ESC
+    // warm start from the model of the previous run when it fits the camera
+    const std::string snapshot = "motion_segmentation.bin";
+    try
     {
-        cap >> frame;
-        buffer.push_back(frame);
-        cv::imshow(main_wnd, frame);
+        cvlib::motion_segmentation restored(buffer.get_mean());
+        restored.load(snapshot);
+        cv::Mat bg;
+        restored.getBackgroundImage(bg);
+        if (bg.size() == buffer[0].size() && bg.type() == buffer[0].type())
+        {
+            mseg = std::move(restored);
+            model = static_cast<int>(mseg.type());
+        }
+    }
+    catch (const cv::Exception&)
+    {
+    }
 
-        mseg.apply(frame, frame_mseg, learning_rate);
-        if (!frame_mseg.empty())
-            cv::imshow(demo_wnd, frame_mseg);
+    cv::createTrackbar("model", demo_wnd, &model, static_cast<int>(cvlib::motion_segmentation::model_type::codebook));
+
+    // trackbars are changed by the sink thread, the worker reads their copies
+    std::atomic<int> selected_model(model);
+    std::atomic<int> selected_rate(rate_track);
+    int current_model = model;
+
+    // the worker is joined before the model is saved
+    {
+        utils::pipeline pipe([&cap](cv::Mat& frame) { return cap.read(frame); },
+                             [&](const cv::Mat& frame) {
+                                 buffer.push_back(frame);
+                                 if (selected_model != current_model)
+                                 {
+                                     current_model = selected_model;
+                                     mseg = cvlib::motion_segmentation(buffer.get_mean(), static_cast<cvlib::motion_segmentation::model_type>(current_model));
+                                     if (mseg.type() == cvlib::motion_segmentation::model_type::running_average)
+                                         mseg.set_adaptive_rate(true);
+                                 }
+
+                                 cv::Mat frame_mseg;
+                                 mseg.apply(frame, frame_mseg, selected_rate / 255.0);
+                                 return frame_mseg;
+                             });
+
+        pipe.run([&](utils::processed_frame& item) {
+            cv::imshow(main_wnd, item.frame);
+            cv::imshow(demo_wnd, item.result);
+            const bool esc = cv::waitKey(1) == 27;
+            selected_model = model;
+            selected_rate = rate_track;
+            return !esc;
+        });
     }
 
+    mseg.save(snapshot);
+
     cv::destroyWindow(main_wnd);
     cv::destroyWindow(demo_wnd);
 
@@ -48,6 +48,10 @@ int demo_select_texture(int argc, char* argv[])
     cv::namedWindow(demo_wnd);
     // \todo choose reasonable max value
     cv::createTrackbar("eps", demo_wnd, &eps, 200);
+    int quantized = 0;
+    cv::createTrackbar("int16", demo_wnd, &quantized, 1);
+    int components = 0;
+    cv::createTrackbar("pca", demo_wnd, &components, 32);
 
     cv::setMouseCallback(data.wnd, mouse, &data);
 
@@ -60,7 +64,10 @@ int demo_select_texture(int argc, char* argv[])
         const cv::Rect roi = {data.tl, data.br};
         if (roi.area())
         {
-            const auto mask = cvlib::select_texture(frame_gray, roi, eps);
+            cvlib::texture_params params;
+            params.quantized = quantized != 0;
+            params.components = components;
+            const auto mask = cvlib::select_texture(frame_gray, roi, eps, params);
             const auto segmented = mask.clone();
             frame_gray.copyTo(segmented, mask);
             cv::imshow(demo_wnd, segmented);
@@ -8,15 +8,16 @@
 
 #include <cvlib.hpp>
 
+#include <atomic>
+
+#include "pipeline.hpp"
+
 int demo_split_and_merge(int argc, char* argv[])
 {
     cv::VideoCapture cap(0);
     if (!cap.isOpened())
         return -1;
 
-    cv::Mat frame;
-    cv::Mat frame_gray;
-
     const auto origin_wnd = "origin";
     const auto demo_wnd = "demo";
 
@@ -25,14 +26,23 @@ int demo_split_and_merge(int argc, char* argv[])
     // \todo choose reasonable max value
     cv::createTrackbar("stdev", demo_wnd, &stddev, 255);
 
-    while (cv::waitKey(30) != 27) // ESC
-    {
-        cap >> frame;
-
-        cv::cvtColor(frame, frame_gray, cv::COLOR_BGR2GRAY);
-        cv::imshow(origin_wnd, frame);
-        cv::imshow(demo_wnd, cvlib::split_and_merge(frame_gray, stddev));
-    }
+    // the trackbar is changed by the sink thread, the worker reads its copy
+    std::atomic<int> selected_stddev(stddev);
+
+    utils::pipeline pipe([&cap](cv::Mat& frame) { return cap.read(frame); },
+                         [&](const cv::Mat& frame) {
+                             cv::Mat frame_gray;
+                             cv::cvtColor(frame, frame_gray, cv::COLOR_BGR2GRAY);
+                             return cvlib::split_and_merge(frame_gray, selected_stddev);
+                         });
+
+    pipe.run([&](utils::processed_frame& item) {
+        cv::imshow(origin_wnd, item.frame);
+        cv::imshow(demo_wnd, item.result);
+        const bool esc = cv::waitKey(1) == 27; // ESC
+        selected_stddev = stddev;
+        return !esc;
+    });
 
     cv::destroyWindow(origin_wnd);
     cv::destroyWindow(demo_wnd);
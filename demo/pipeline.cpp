@@ -0,0 +1,100 @@
+/* Capture / process / display pipeline implementation.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#include <opencv2/opencv.hpp>
+
+#include "pipeline.hpp"
+
+namespace utils
+{
+pipeline::pipeline(source_fn source, worker_fn worker, size_t queue_size /*= 2*/)
+    : captured_(queue_size), processed_(queue_size), capture_(&pipeline::capture_loop, this, std::move(source)),
+      worker_(&pipeline::worker_loop, this, std::move(worker))
+{
+}
+
+pipeline::~pipeline()
+{
+    running_ = false;
+    notify(captured_ready_);
+    capture_.join();
+    worker_.join();
+}
+
+void pipeline::run(const sink_fn& sink)
+{
+    processed_frame item;
+    while (true)
+    {
+        if (processed_.pop(item))
+        {
+            if (!sink(item))
+            {
+                break;
+            }
+        }
+        else if (worker_done_)
+        {
+            break;
+        }
+        else
+        {
+            wait_for(processed_, processed_ready_, worker_done_);
+        }
+    }
+    running_ = false;
+    notify(captured_ready_);
+}
+
+void pipeline::capture_loop(source_fn source)
+{
+    while (running_)
+    {
+        cv::Mat frame;
+        if (!source(frame) || frame.empty())
+        {
+            break;
+        }
+        captured_.push(std::move(frame));
+        notify(captured_ready_);
+    }
+    capture_done_ = true;
+    notify(captured_ready_);
+}
+
+void pipeline::worker_loop(worker_fn worker)
+{
+    cv::Mat frame;
+    while (running_)
+    {
+        if (captured_.pop(frame))
+        {
+            processed_.push({frame, worker(frame)});
+            notify(processed_ready_);
+        }
+        else if (capture_done_)
+        {
+            break;
+        }
+        else
+        {
+            wait_for(captured_, captured_ready_, capture_done_);
+        }
+    }
+    worker_done_ = true;
+    notify(processed_ready_);
+}
+
+void pipeline::notify(std::condition_variable& ready)
+{
+    // the waiter checks its condition under the lock, so taking it here closes the gap
+    // between that check and the wait, and the notification can not be lost
+    {
+        std::lock_guard<std::mutex> lock(wake_lock_);
+    }
+    ready.notify_one();
+}
+} // namespace utils
@@ -0,0 +1,205 @@
+/* Capture / process / display pipeline for demo applications of Computer Vision Library.
+ * @file
+ * @date 2026-10-19
+ * @author Anonymous
+ */
+
+#ifndef __PIPELINE_HPP__
+#define __PIPELINE_HPP__
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace utils
+{
+/// \brief Bounded lock-free ring queue for one producer and one consumer, which drops the oldest item when full
+///        Every slot carries a sequence number (bounded queue of D. Vyukov), so the producer may take the oldest
+///        item out itself while the consumer is reading another slot
+template <typename T>
+class ring_queue
+{
+    public:
+    /// \brief ctor
+    /// \param capacity, in - number of slots, rounded up to the power of two
+    explicit ring_queue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        slots_.reset(new slot[size]);
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; ++i)
+        {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /// \brief Pushes item, the oldest one is dropped when queue is full
+    /// \return false when an item was dropped
+    bool push(T item)
+    {
+        bool dropped = false;
+        T oldest;
+        while (!try_push(item))
+        {
+            // the push can fail after the drop only while consumer finishes reading the slot
+            if (!dropped && pop(oldest))
+            {
+                dropped = true;
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        return !dropped;
+    }
+
+    /// \brief Pops the oldest item
+    /// \return false when queue is empty
+    bool pop(T& item)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& s = slots_[pos & mask_];
+            const auto diff = static_cast<intptr_t>(s.seq.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+            if (diff < 0)
+            {
+                return false;
+            }
+            if (diff == 0 && tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                item = std::move(s.item);
+                s.seq.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+            if (diff > 0)
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// \brief Checks whether queue has no items, exact only when neither side is in progress
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    /// \brief Number of items dropped since creation
+    size_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    private:
+    struct slot
+    {
+        std::atomic<size_t> seq;
+        T item;
+    };
+
+    bool try_push(T& item)
+    {
+        const size_t pos = head_.load(std::memory_order_relaxed);
+        slot& s = slots_[pos & mask_];
+        if (s.seq.load(std::memory_order_acquire) != pos)
+        {
+            return false;
+        }
+        s.item = std::move(item);
+        s.seq.store(pos + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::unique_ptr<slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<size_t> head_{0}; ///< position of the next push, changed by producer only
+    std::atomic<size_t> tail_{0}; ///< position of the next pop
+    std::atomic<size_t> dropped_{0};
+};
+
+/// \brief Captured frame with the result of its processing
+struct processed_frame
+{
+    cv::Mat frame;
+    cv::Mat result;
+};
+
+/// \brief Three-stage pipeline: capture thread, worker thread and sink in the calling thread
+///        Stages are connected by ring queues dropping the oldest frames, so throughput is limited
+///        by the slowest stage instead of the sum of all stages. A stage with an empty input queue sleeps
+///        on a condition variable, the lock is taken only around waits and notifications, not queue operations
+class pipeline
+{
+    public:
+    using source_fn = std::function<bool(cv::Mat&)>; ///< reads the next frame, false at the end of stream
+    using worker_fn = std::function<cv::Mat(const cv::Mat&)>; ///< processes the frame
+    using sink_fn = std::function<bool(processed_frame&)>; ///< shows the result, false to stop
+
+    /// \brief ctor, starts capture and worker threads
+    /// \param source, in - called from capture thread
+    /// \param worker, in - called from worker thread
+    /// \param queue_size, in - capacity of queues between stages
+    pipeline(source_fn source, worker_fn worker, size_t queue_size = 2);
+
+    /// \brief dtor, stops and joins threads
+    ~pipeline();
+
+    /// \brief Passes processed frames to the sink in the calling thread (HighGUI must be used from it)
+    ///        until the sink returns false or the stream ends
+    void run(const sink_fn& sink);
+
+    /// \brief Number of captured frames dropped since worker was busy
+    size_t dropped_captured() const
+    {
+        return captured_.dropped();
+    }
+
+    /// \brief Number of processed frames dropped since sink was busy
+    size_t dropped_processed() const
+    {
+        return processed_.dropped();
+    }
+
+    private:
+    void capture_loop(source_fn source);
+    void worker_loop(worker_fn worker);
+
+    /// \brief Wakes the stage waiting on ready
+    void notify(std::condition_variable& ready);
+
+    /// \brief Waits until queue has an item, previous stage is done or pipeline stops
+    template <typename T>
+    void wait_for(const ring_queue<T>& queue, std::condition_variable& ready, const std::atomic<bool>& done)
+    {
+        std::unique_lock<std::mutex> lock(wake_lock_);
+        ready.wait(lock, [&] { return !queue.empty() || done || !running_; });
+    }
+
+    ring_queue<cv::Mat> captured_;
+    ring_queue<processed_frame> processed_;
+    std::atomic<bool> running_{true};
+    std::atomic<bool> capture_done_{false};
+    std::atomic<bool> worker_done_{false};
+    std::mutex wake_lock_;
+    std::condition_variable captured_ready_;
+    std::condition_variable processed_ready_;
+    std::thread capture_;
+    std::thread worker_;
+};
+} // namespace utils
+
+#endif // __PIPELINE_HPP__